@@ -0,0 +1,38 @@
+//
+// Created by Samuel Stephens on 19/10/2026.
+//
+
+#include "AccumulationBuffer.h"
+#include <algorithm>
+
+AccumulationBuffer::AccumulationBuffer() {
+    width = 0;
+    height = 0;
+    samples = 0;
+    seconds = 0;
+}
+
+AccumulationBuffer::AccumulationBuffer(size_t width, size_t height) {
+    this->width = width;
+    this->height = height;
+    this->sums = std::vector<glm::vec3>(width * height, glm::vec3(0, 0, 0));
+    this->samples = 0;
+    this->seconds = 0;
+}
+
+glm::vec3 &AccumulationBuffer::at(size_t x, size_t y) {
+    return sums[y * width + x];
+}
+
+// Paths traced per second over everything accumulated so far
+double AccumulationBuffer::samplesPerSecond() const {
+    if (seconds <= 0) return 0;
+    return static_cast<double>(width * height) * samples / seconds;
+}
+
+// Drops everything, for when the view or lighting changes
+void AccumulationBuffer::reset() {
+    std::fill(sums.begin(), sums.end(), glm::vec3(0, 0, 0));
+    samples = 0;
+    seconds = 0;
+}
@@ -0,0 +1,29 @@
+//
+// Created by Samuel Stephens on 19/10/2026.
+//
+
+#ifndef ACCUMULATIONBUFFER_H
+#define ACCUMULATIONBUFFER_H
+#include <vector>
+#include <glm/glm.hpp>
+
+// Running per-pixel sums of unclamped (HDR) path traced radiance, so passes made while the view is still average
+// into a converging image
+class AccumulationBuffer {
+    public:
+    size_t width;
+    size_t height;
+    std::vector<glm::vec3> sums;
+    int samples;            // passes summed into every pixel
+    double seconds;         // time spent tracing those passes
+
+    AccumulationBuffer();
+    explicit AccumulationBuffer(size_t width, size_t height);
+    glm::vec3 &at(size_t x, size_t y);
+    double samplesPerSecond() const;
+    void reset();
+};
+
+
+
+#endif //ACCUMULATIONBUFFER_H
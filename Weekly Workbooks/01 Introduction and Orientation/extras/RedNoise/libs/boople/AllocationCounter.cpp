@@ -0,0 +1,34 @@
+//
+// Created by Samuel Stephens on 19/10/2026.
+//
+
+#include "AllocationCounter.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+static std::atomic<unsigned long> allocations(0);
+
+unsigned long AllocationCounter::count() {
+    return allocations.load(std::memory_order_relaxed);
+}
+
+// Replacing the global allocation functions counts everything, including the standard containers.
+// The array and nothrow forms fall through to these. Release builds keep the standard allocator, since only debug
+// builds read the count.
+#ifndef NDEBUG
+void *operator new(std::size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    void *pointer = std::malloc(size == 0 ? 1 : size);
+    if (pointer == nullptr) throw std::bad_alloc();
+    return pointer;
+}
+
+void operator delete(void *pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void *pointer, std::size_t) noexcept {
+    std::free(pointer);
+}
+#endif
@@ -0,0 +1,17 @@
+//
+// Created by Samuel Stephens on 19/10/2026.
+//
+
+#ifndef ALLOCATIONCOUNTER_H
+#define ALLOCATIONCOUNTER_H
+
+// Counts every heap allocation made through operator new, so a frame's allocations can be measured by
+// taking the difference of two readings. Only debug builds count; with NDEBUG the count stays at 0.
+class AllocationCounter {
+    public:
+    static unsigned long count();
+};
+
+
+
+#endif //ALLOCATIONCOUNTER_H
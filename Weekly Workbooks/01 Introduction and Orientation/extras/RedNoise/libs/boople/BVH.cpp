@@ -0,0 +1,378 @@
+//
+// Created by Samuel Stephens on 19/10/2026.
+//
+
+#include "BVH.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// the most primitives a leaf is left with
+const int BVH_LEAF_SIZE = 4;
+// how many bins SAH sorts a node's centres into along each axis
+const int BVH_BINS = 16;
+// nodes with more primitives than this have their children built as separate tasks
+const int BVH_TASK_SIZE = 4096;
+// past this depth SAH hands over to median splits, so traversal's stack can't overflow
+const int BVH_SAH_DEPTH = 64;
+
+// What every node of one build shares. Nodes are handed out in pairs from the front of the array, which was made big
+// enough for the worst case, so tasks building different subtrees never have to lock anything.
+struct BVHBuild {
+    const std::vector<BoundingBox> &bounds;
+    BVHMethod method;
+    std::vector<glm::vec3> centres;
+    std::vector<uint32_t> codes;        // Morton codes of the centres, for LBVH
+    std::atomic<int> used;
+
+    BVHBuild(const std::vector<BoundingBox> &bounds, BVHMethod method) : bounds(bounds), method(method), used(1) {
+    }
+};
+
+// Every axis's SAH bins for one run of primitives
+struct SAHBins {
+    BoundingBox bounds[3][BVH_BINS];
+    int counts[3][BVH_BINS] = {};
+};
+
+// How many slices a pass over a node's primitives is split into: one per thread for nodes big enough to be worth the
+// tasks, so the passes over the root and the nodes just below it aren't left to a single core
+static int slicesFor(int count) {
+#ifdef _OPENMP
+    if (count > BVH_TASK_SIZE) return omp_get_num_threads();
+#endif
+    return 1;
+}
+
+// Where slice starts among count primitives from first (and so where the one before it ends)
+static int sliceStart(int first, int count, int slice, int slices) {
+    return first + static_cast<int>(static_cast<long long>(count) * slice / slices);
+}
+
+// Grows box around the primitives order[begin, end) and centroids around their centres
+static void growBounds(const std::vector<int> &order, int begin, int end, const BVHBuild &build, BoundingBox &box, BoundingBox &centroids) {
+    for (int k = begin; k < end; k++) {
+        box.grow(build.bounds[order[k]]);
+        centroids.grow(build.centres[order[k]]);
+    }
+}
+
+// Sorts the centres of order[begin, end) into bins along every axis at once. An axis with a scale of 0 has no extent
+// to split and is skipped.
+static void binCentres(const std::vector<int> &order, int begin, int end, const BoundingBox &centroids, const glm::vec3 &scale, const BVHBuild &build, SAHBins &bins) {
+    for (int k = begin; k < end; k++) {
+        const int primitive = order[k];
+        for (int axis = 0; axis < 3; axis++) {
+            if (scale[axis] <= 0) continue;
+            int bin = std::min(BVH_BINS - 1, static_cast<int>((build.centres[primitive][axis] - centroids.lower[axis]) * scale[axis]));
+            bins.bounds[axis][bin].grow(build.bounds[primitive]);
+            bins.counts[axis][bin]++;
+        }
+    }
+}
+
+// Sorts order by the primitives' 30 bit Morton codes, 10 bits a pass from the bottom up, every pass stable so it keeps
+// the order the ones before it left. Each thread counts its own slice of order into its own buckets, then scatters
+// that same slice, so the passes need no locking.
+static void radixSortByCode(std::vector<int> &order, const std::vector<uint32_t> &codes) {
+    const int count = static_cast<int>(order.size());
+    const int buckets = 1024;
+    std::vector<int> sorted(order.size());
+    std::vector<int> offsets;
+    for (int shift = 0; shift < 30; shift += 10) {
+#pragma omp parallel
+        {
+            int threads = 1, thread = 0;
+#ifdef _OPENMP
+            threads = omp_get_num_threads();
+            thread = omp_get_thread_num();
+#endif
+#pragma omp single
+            offsets.assign(static_cast<size_t>(threads) * buckets, 0);
+            int *mine = offsets.data() + static_cast<size_t>(thread) * buckets;
+            const int begin = sliceStart(0, count, thread, threads), end = sliceStart(0, count, thread + 1, threads);
+            for (int k = begin; k < end; k++) mine[(codes[order[k]] >> shift) & (buckets - 1)]++;
+#pragma omp barrier
+#pragma omp single
+            {
+                // bucket by bucket, then thread by thread within a bucket, which keeps equal digits in their old order
+                int total = 0;
+                for (int bucket = 0; bucket < buckets; bucket++) {
+                    for (int other = 0; other < threads; other++) {
+                        int &offset = offsets[static_cast<size_t>(other) * buckets + bucket];
+                        const int inBucket = offset;
+                        offset = total;
+                        total += inBucket;
+                    }
+                }
+            }
+            for (int k = begin; k < end; k++) sorted[mine[(codes[order[k]] >> shift) & (buckets - 1)]++] = order[k];
+        }
+        order.swap(sorted);
+    }
+}
+
+// Spreads the low 10 bits of value out to every third bit
+static uint32_t spreadBits(uint32_t value) {
+    value = (value | (value << 16)) & 0x030000FF;
+    value = (value | (value << 8)) & 0x0300F00F;
+    value = (value | (value << 4)) & 0x030C30C3;
+    value = (value | (value << 2)) & 0x09249249;
+    return value;
+}
+
+// The 30 bit Morton code of a point inside box, interleaving 10 bits of each coordinate
+static uint32_t mortonCode(const glm::vec3 &point, const BoundingBox &box) {
+    glm::vec3 unit = (point - box.lower) / glm::max(box.upper - box.lower, glm::vec3(1e-20f));
+    glm::vec3 cell = glm::clamp(unit * 1024.0f, glm::vec3(0), glm::vec3(1023));
+    return (spreadBits(static_cast<uint32_t>(cell.x)) << 2) | (spreadBits(static_cast<uint32_t>(cell.y)) << 1) | spreadBits(static_cast<uint32_t>(cell.z));
+}
+
+// Number of leading zero bits, 32 for zero
+static int leadingZeros(uint32_t value) {
+    int zeros = 0;
+    for (uint32_t bit = 0x80000000u; bit != 0 && !(value & bit); bit >>= 1) zeros++;
+    return zeros;
+}
+
+BoundingBox::BoundingBox()
+    : lower(std::numeric_limits<float>::max()), upper(-std::numeric_limits<float>::max()) {
+}
+
+void BoundingBox::grow(const glm::vec3 &point) {
+    lower = glm::min(lower, point);
+    upper = glm::max(upper, point);
+}
+
+void BoundingBox::grow(const BoundingBox &box) {
+    lower = glm::min(lower, box.lower);
+    upper = glm::max(upper, box.upper);
+}
+
+glm::vec3 BoundingBox::centre() const {
+    return (lower + upper) * 0.5f;
+}
+
+float BoundingBox::area() const {
+    glm::vec3 size = glm::max(upper - lower, glm::vec3(0));
+    return 2 * (size.x * size.y + size.y * size.z + size.z * size.x);
+}
+
+// How far along the ray it enters the box (0 if it starts inside), or infinity if it misses or only gets there after nearest
+float BoundingBox::entry(const glm::vec3 &origin, const glm::vec3 &inverseDirection, float nearest) const {
+    glm::vec3 a = (lower - origin) * inverseDirection;
+    glm::vec3 b = (upper - origin) * inverseDirection;
+    glm::vec3 near = glm::min(a, b), far = glm::max(a, b);
+    float enter = std::max(std::max(near.x, near.y), std::max(near.z, 0.0f));
+    float leave = std::min(std::min(far.x, far.y), std::min(far.z, nearest));
+    return enter <= leave ? enter : std::numeric_limits<float>::infinity();
+}
+
+BVH::BVH() = default;
+
+BVH::BVH(const std::vector<BoundingBox> &bounds, BVHMethod method) {
+    build(bounds, method);
+}
+
+// Builds the hierarchy top down, splitting each node as method says. Subtrees big enough to be worth it are built as
+// OpenMP tasks, so the cores split the work between them once the first few splits have been made.
+void BVH::build(const std::vector<BoundingBox> &bounds, BVHMethod method) {
+    nodes.clear();
+    order.resize(bounds.size());
+    if (bounds.empty()) return;
+    const int primitives = static_cast<int>(bounds.size());
+    BVHBuild build(bounds, method);
+    build.centres.resize(bounds.size());
+#pragma omp parallel for
+    for (int index = 0; index < primitives; index++) {
+        order[index] = index;
+        build.centres[index] = bounds[index].centre();
+    }
+    if (method == BVHMethod::LBVH) {
+        BoundingBox centroids = BoundingBox();
+        for (const auto &centre : build.centres) centroids.grow(centre);
+        build.codes.resize(bounds.size());
+#pragma omp parallel for
+        for (int index = 0; index < primitives; index++) build.codes[index] = mortonCode(build.centres[index], centroids);
+        radixSortByCode(order, build.codes);
+    }
+    // a binary tree with n leaves has 2n - 1 nodes, and there are at most as many leaves as primitives
+    nodes.resize(2 * bounds.size() - 1);
+    nodes[0] = {BoundingBox(), 0, primitives};
+#pragma omp parallel
+#pragma omp single
+    subdivide(0, build, 0);
+    nodes.resize(build.used);
+    nodes.shrink_to_fit();
+}
+
+// Moves the boxes to fit primitives that have moved, keeping the tree as it is. Children always come after their
+// parent in nodes, so one backwards pass sees every child before its parent. Quicker than build by far, but the tree
+// gets worse the further the primitives stray from where it was built.
+void BVH::refit(const std::vector<BoundingBox> &bounds) {
+    for (int index = static_cast<int>(nodes.size()) - 1; index >= 0; index--) {
+        BVHNode &node = nodes[index];
+        node.bounds = BoundingBox();
+        if (node.count > 0) {
+            for (int k = node.first; k < node.first + node.count; k++) node.bounds.grow(bounds[order[k]]);
+        } else {
+            node.bounds.grow(nodes[node.first].bounds);
+            node.bounds.grow(nodes[node.first + 1].bounds);
+        }
+    }
+}
+
+// The surface area heuristic's estimate of what a ray through the root costs, with a node visit and a primitive test
+// costing the same. Lower is better; it's how the builders are compared.
+float BVH::cost() const {
+    if (nodes.empty()) return 0;
+    float total = 0;
+    for (const auto &node : nodes) total += node.bounds.area() * (node.count > 0 ? node.count : 1);
+    return total / nodes[0].bounds.area();
+}
+
+size_t BVH::bytes() const {
+    return nodes.capacity() * sizeof(BVHNode) + order.capacity() * sizeof(int);
+}
+
+void BVH::subdivide(int node, BVHBuild &build, int depth) {
+    const int first = nodes[node].first, count = nodes[node].count;
+    BoundingBox box = BoundingBox(), centroids = BoundingBox();
+    const int slices = slicesFor(count);
+    if (slices > 1) {
+        // each thread boxes a slice of the primitives, and the slices' boxes are merged
+        std::vector<BoundingBox> boxes(slices), centres(slices);
+#pragma omp taskgroup
+        {
+            for (int slice = 0; slice < slices; slice++) {
+#pragma omp task shared(boxes, centres, build)
+                growBounds(order, sliceStart(first, count, slice, slices), sliceStart(first, count, slice + 1, slices), build, boxes[slice], centres[slice]);
+            }
+        }
+        for (int slice = 0; slice < slices; slice++) {
+            box.grow(boxes[slice]);
+            centroids.grow(centres[slice]);
+        }
+    } else {
+        growBounds(order, first, first + count, build, box, centroids);
+    }
+    nodes[node].bounds = box;
+    if (count <= BVH_LEAF_SIZE) return;
+    int half = 0;
+    if (build.method == BVHMethod::LBVH) half = splitMorton(first, count, build);
+    else if (build.method == BVHMethod::SAH && depth < BVH_SAH_DEPTH) half = splitBinnedSAH(first, count, centroids, build);
+    if (half <= 0 || half >= count) half = splitMedian(first, count, centroids, build);
+    const int left = build.used.fetch_add(2);
+    nodes[left] = {BoundingBox(), first, half};
+    nodes[left + 1] = {BoundingBox(), first + half, count - half};
+    nodes[node].first = left;
+    nodes[node].count = 0;
+    if (count > BVH_TASK_SIZE) {
+#pragma omp task shared(build)
+        subdivide(left, build, depth + 1);
+    } else {
+        subdivide(left, build, depth + 1);
+    }
+    subdivide(left + 1, build, depth + 1);
+}
+
+// Puts the lower half of the node's centres along their longest axis first and returns how many that is
+int BVH::splitMedian(int first, int count, const BoundingBox &centroids, const BVHBuild &build) {
+    glm::vec3 extent = centroids.upper - centroids.lower;
+    int axis = extent.x > extent.y && extent.x > extent.z ? 0 : (extent.y > extent.z ? 1 : 2);
+    const int half = count / 2;
+    std::nth_element(order.begin() + first, order.begin() + first + half, order.begin() + first + count, [&](int a, int b) {
+        return build.centres[a][axis] < build.centres[b][axis];
+    });
+    return half;
+}
+
+// Sorts the node's centres into bins along each axis, and splits between the two bins where the primitives' boxes
+// on either side give the lowest surface area heuristic cost. Returns how many primitives went left, or 0 if the
+// centres all sit on one point.
+int BVH::splitBinnedSAH(int first, int count, const BoundingBox &centroids, const BVHBuild &build) {
+    glm::vec3 scale = glm::vec3(0);
+    for (int axis = 0; axis < 3; axis++) {
+        const float extent = centroids.upper[axis] - centroids.lower[axis];
+        if (extent > 0) scale[axis] = BVH_BINS / extent;
+    }
+    SAHBins bins = SAHBins();
+    const int slices = slicesFor(count);
+    if (slices > 1) {
+        // each thread bins a slice of the primitives into bins of its own, which are merged once they're all done
+        std::vector<SAHBins> sliceBins(slices);
+#pragma omp taskgroup
+        {
+            for (int slice = 0; slice < slices; slice++) {
+#pragma omp task shared(sliceBins, scale, centroids, build)
+                binCentres(order, sliceStart(first, count, slice, slices), sliceStart(first, count, slice + 1, slices), centroids, scale, build, sliceBins[slice]);
+            }
+        }
+        for (const auto &slice : sliceBins) {
+            for (int axis = 0; axis < 3; axis++) {
+                for (int bin = 0; bin < BVH_BINS; bin++) {
+                    bins.bounds[axis][bin].grow(slice.bounds[axis][bin]);
+                    bins.counts[axis][bin] += slice.counts[axis][bin];
+                }
+            }
+        }
+    } else {
+        binCentres(order, first, first + count, centroids, scale, build, bins);
+    }
+    float bestCost = std::numeric_limits<float>::max();
+    int bestAxis = -1, bestBin = 0;
+    for (int axis = 0; axis < 3; axis++) {
+        if (scale[axis] <= 0) continue;
+        const BoundingBox *boxes = bins.bounds[axis];
+        const int *counts = bins.counts[axis];
+        // sweep in from the right, then in from the left, pricing each split on the way
+        float rightArea[BVH_BINS];
+        int rightCount[BVH_BINS];
+        BoundingBox right = BoundingBox();
+        int inRight = 0;
+        for (int bin = BVH_BINS - 1; bin > 0; bin--) {
+            right.grow(boxes[bin]);
+            inRight += counts[bin];
+            rightArea[bin] = right.area();
+            rightCount[bin] = inRight;
+        }
+        BoundingBox left = BoundingBox();
+        int inLeft = 0;
+        for (int bin = 0; bin < BVH_BINS - 1; bin++) {
+            left.grow(boxes[bin]);
+            inLeft += counts[bin];
+            float cost = inLeft * left.area() + rightCount[bin + 1] * rightArea[bin + 1];
+            if (inLeft > 0 && rightCount[bin + 1] > 0 && cost < bestCost) {
+                bestCost = cost;
+                bestAxis = axis;
+                bestBin = bin;
+            }
+        }
+    }
+    if (bestAxis < 0) return 0;
+    const float lower = centroids.lower[bestAxis];
+    auto middle = std::partition(order.begin() + first, order.begin() + first + count, [&](int primitive) {
+        return std::min(BVH_BINS - 1, static_cast<int>((build.centres[primitive][bestAxis] - lower) * scale[bestAxis])) <= bestBin;
+    });
+    return static_cast<int>(middle - (order.begin() + first));
+}
+
+// The primitives are already in Morton order, so split where the highest bit that differs across the node flips.
+// Returns 0 when every code in the node is the same.
+int BVH::splitMorton(int first, int count, const BVHBuild &build) const {
+    const uint32_t firstCode = build.codes[order[first]], lastCode = build.codes[order[first + count - 1]];
+    if (firstCode == lastCode) return 0;
+    const int prefix = leadingZeros(firstCode ^ lastCode);
+    // binary search for the last primitive that still shares more than prefix leading bits with the first
+    int low = 0, high = count - 1;
+    while (high - low > 1) {
+        int middle = (low + high) / 2;
+        if (leadingZeros(firstCode ^ build.codes[order[first + middle]]) > prefix) low = middle;
+        else high = middle;
+    }
+    return low + 1;
+}
@@ -0,0 +1,97 @@
+//
+// Created by Samuel Stephens on 19/10/2026.
+//
+
+#ifndef BVH_H
+#define BVH_H
+#include <cstddef>
+#include <vector>
+#include <glm/glm.hpp>
+
+// An axis aligned box, empty until something is grown into it
+struct BoundingBox {
+    glm::vec3 lower;
+    glm::vec3 upper;
+
+    BoundingBox();
+    void grow(const glm::vec3 &point);
+    void grow(const BoundingBox &box);
+    glm::vec3 centre() const;
+    float area() const;
+    float entry(const glm::vec3 &origin, const glm::vec3 &inverseDirection, float nearest) const;
+};
+
+// Leaves hold count primitives starting at first in the order array. Inner nodes have count 0 and their two children
+// next to each other at first and first + 1.
+struct BVHNode {
+    BoundingBox bounds;
+    int first;
+    int count;
+};
+
+// How a BVH picks its splits. MEDIAN halves every node along its longest axis. SAH bins the primitives' centres and
+// takes the split with the lowest surface area heuristic cost, for the fastest trees. LBVH sorts the primitives along
+// a Morton curve once and splits where the codes change, which builds quickest and suits geometry rebuilt every frame.
+enum class BVHMethod {MEDIAN, SAH, LBVH};
+
+struct BVHBuild;
+
+// A bounding volume hierarchy over anything that can be boxed: triangles for a mesh, whole instances for the top level
+// of an InstancedScene. It only stores primitive indices, so the primitives themselves stay wherever they already live.
+class BVH {
+    public:
+    std::vector<BVHNode> nodes;
+    std::vector<int> order;         // primitive indices, grouped by leaf
+
+    BVH();
+    explicit BVH(const std::vector<BoundingBox> &bounds, BVHMethod method = BVHMethod::SAH);
+    void build(const std::vector<BoundingBox> &bounds, BVHMethod method = BVHMethod::SAH);
+    void refit(const std::vector<BoundingBox> &bounds);
+    float cost() const;
+    size_t bytes() const;
+
+    // Calls visit(primitive, nearest) for each primitive in a leaf the ray enters before nearest, nearest leaves first.
+    // visit shortens nearest when it finds a closer hit, and returns true to stop the walk (for shadow rays).
+    template <typename Visit>
+    bool traverse(const glm::vec3 &origin, const glm::vec3 &direction, float &nearest, Visit visit) const;
+
+    private:
+    void subdivide(int node, BVHBuild &build, int depth);
+    int splitMedian(int first, int count, const BoundingBox &centroids, const BVHBuild &build);
+    int splitBinnedSAH(int first, int count, const BoundingBox &centroids, const BVHBuild &build);
+    int splitMorton(int first, int count, const BVHBuild &build) const;
+};
+
+template <typename Visit>
+bool BVH::traverse(const glm::vec3 &origin, const glm::vec3 &direction, float &nearest, Visit visit) const {
+    if (nodes.empty()) return false;
+    const glm::vec3 inverseDirection = 1.0f / direction;
+    int stack[128];
+    int depth = 0;
+    stack[depth++] = 0;
+    while (depth > 0) {
+        const BVHNode &node = nodes[stack[--depth]];
+        if (node.bounds.entry(origin, inverseDirection, nearest) > nearest) continue;
+        if (node.count > 0) {
+            for (int k = node.first; k < node.first + node.count; k++) {
+                if (visit(order[k], nearest)) return true;
+            }
+            continue;
+        }
+        // push the farther child first so the nearer one is walked first and shortens nearest for the other
+        float left = nodes[node.first].bounds.entry(origin, inverseDirection, nearest);
+        float right = nodes[node.first + 1].bounds.entry(origin, inverseDirection, nearest);
+        if (left <= right) {
+            if (right <= nearest) stack[depth++] = node.first + 1;
+            if (left <= nearest) stack[depth++] = node.first;
+        } else {
+            if (left <= nearest) stack[depth++] = node.first;
+            if (right <= nearest) stack[depth++] = node.first + 1;
+        }
+    }
+    return false;
+}
+
+
+
+#endif //BVH_H
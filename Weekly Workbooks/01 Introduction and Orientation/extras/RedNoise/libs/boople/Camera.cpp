@@ -3,6 +3,7 @@
 //
 
 #include "Camera.h"
+#include <cmath>
 #include <glm/gtx/string_cast.hpp>
 
 Camera::Camera() {
@@ -19,21 +20,25 @@ Camera::Camera(glm::vec3 position, glm::mat3 orientation, float focalLength) {
 
 void Camera::translateCamera(glm::vec3 delta) {
     position -= delta;
+    revision++;
 }
 
 void Camera::panCamera(float theta) {
     glm::mat3 matrix = glm::mat3(glm::vec3(glm::cos(theta),0,-glm::sin(theta)),glm::vec3(0,1,0),glm::vec3(glm::sin(theta),0,glm::cos(theta)));
     orientation = orientation*matrix;
+    revision++;
 }
 
 void Camera::tiltCamera(float theta) {
     glm::mat3 matrix = glm::mat3(glm::vec3(1,0,0),glm::vec3(0,glm::cos(theta),glm::sin(theta)),glm::vec3(0, -glm::sin(theta), glm::cos(theta)));
     orientation = orientation * matrix;
+    revision++;
 }
 
 void Camera::orbit(float speed) {
     glm::mat3 matrix = glm::mat3(glm::vec3(glm::cos(speed),0,-glm::sin(speed)),glm::vec3(0,1,0),glm::vec3(glm::sin(speed),0,glm::cos(speed)));
     position = matrix*position;
+    revision++;
 }
 
 void Camera::lookAt(glm::vec3 point) {
@@ -42,4 +47,31 @@ void Camera::lookAt(glm::vec3 point) {
     glm::vec3 up = -normalize(cross(right, forward));
     glm::mat3 boop = {glm::vec3(-1,0,0), glm::vec3(0,-1,0), glm::vec3(0,0,1)};
     orientation = boop*glm::mat3(right, up, forward);
+    revision++;
+}
+
+void Camera::setPose(glm::vec3 newPosition, glm::mat3 newOrientation) {
+    position = newPosition;
+    orientation = newOrientation;
+    revision++;
+}
+
+void Camera::changeMode(std::string newMode) {
+    mode = newMode;
+}
+
+bool Camera::raytraced() const {
+    return raytracedMode(mode);
+}
+
+// True for the modes that are drawn by raytracing rather than by the rasteriser
+bool Camera::raytracedMode(const std::string &mode) {
+    return mode != "WIREFRAME" && mode != "RASTERISE" && mode != "SPHERE_W" && mode != "RECORD";
+}
+
+// Pixels per unit on the image plane (focalLength in front of the camera) for a frame that is height pixels tall.
+// The rasteriser scales projected points by this and the raytracer steps its primary rays by its inverse, so both
+// frame the same view at any resolution.
+float Camera::pixelScale(size_t height) const {
+    return height / (2 * focalLength * std::tan(glm::radians(fieldOfView) / 2));
 }
\ No newline at end of file
@@ -4,6 +4,7 @@
 
 #ifndef CAMERA_H
 #define CAMERA_H
+#include <cstddef>
 #include <string>
 #include <../glm-0.9.7.2/glm/detail/type_mat.hpp>
 #include <../glm-0.9.7.2/glm/detail/type_mat3x3.hpp>
@@ -16,7 +17,9 @@ public:
     glm::vec3 position;
     glm::mat3 orientation;
     float focalLength;
+    float fieldOfView = 64;     // vertical, in degrees; with the frame height it sets how many pixels a unit on the image plane covers
     std::string mode;
+    unsigned long revision = 0; // bumped whenever the pose changes, so renderers can tell if a frame is stale
 
     Camera();
     explicit Camera(glm::vec3 position, glm::mat3 orientation, float focalLength);
@@ -26,7 +29,11 @@ public:
     void orbit(float speed);
     void lookAt(glm::vec3 point);
 
+    void setPose(glm::vec3 newPosition, glm::mat3 newOrientation);
     void changeMode(std::string newMode);
+    bool raytraced() const;
+    float pixelScale(size_t height) const;
+    static bool raytracedMode(const std::string &mode);
 };
 
 
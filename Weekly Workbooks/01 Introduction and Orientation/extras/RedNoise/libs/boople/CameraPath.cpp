@@ -0,0 +1,109 @@
+//
+// Created by Samuel Stephens on 19/10/2026.
+//
+
+#include "CameraPath.h"
+#include <algorithm>
+
+CameraPath::CameraPath() = default;
+
+// Recordings without times were taken one pose per 1/300 s tick
+CameraPath::CameraPath(const RecordingReader &recording) {
+    const bool timed = recording.header.flags & RECORDING_HAS_TIME;
+    keys.reserve(recording.size());
+    for (size_t index = 0; index < recording.size(); index++) {
+        const PoseRecord &pose = recording[index];
+        CameraKey key = CameraKey();
+        key.time = timed ? pose.time : index / 300.0f;
+        key.position = pose.cameraPosition();
+        key.orientation = glm::normalize(glm::quat_cast(pose.cameraOrientation()));
+        key.light = pose.lightPosition();
+        if (recording.header.flags & RECORDING_HAS_MODE) key.mode = pose.modeName();
+        addKey(key);
+    }
+}
+
+// Keys have to come in time order; one that doesn't move the clock on would make a zero-length segment, so it takes
+// the place of the key before it instead
+void CameraPath::addKey(const CameraKey &key) {
+    if (!keys.empty() && key.time <= keys.back().time) {
+        const float time = keys.back().time;
+        keys.back() = key;
+        keys.back().time = time;
+    } else {
+        keys.push_back(key);
+    }
+    // q and -q are the same rotation, keep neighbours in the same hemisphere so slerp takes the short way round
+    if (keys.size() > 1 && glm::dot(keys[keys.size() - 2].orientation, keys.back().orientation) < 0) {
+        keys.back().orientation = -keys.back().orientation;
+    }
+}
+
+size_t CameraPath::size() const {
+    return keys.size();
+}
+
+float CameraPath::duration() const {
+    return keys.empty() ? 0 : keys.back().time - keys.front().time;
+}
+
+// Returns the key that starts the segment containing time (measured from the first key) and how far through it is
+size_t CameraPath::segment(float time, float &fraction) const {
+    fraction = 0;
+    if (keys.size() < 2) return 0;
+    const float absolute = keys.front().time + time;
+    if (absolute <= keys.front().time) return 0;
+    if (absolute >= keys.back().time) {
+        fraction = 1;
+        return keys.size() - 2;
+    }
+    auto after = std::upper_bound(keys.begin(), keys.end(), absolute, [](float t, const CameraKey &key) { return t < key.time; });
+    const size_t index = static_cast<size_t>(after - keys.begin()) - 1;
+    fraction = (absolute - keys[index].time) / (keys[index + 1].time - keys[index].time);
+    return index;
+}
+
+// Velocity at a key, from its neighbours (or from the one neighbour at either end of the path)
+glm::vec3 CameraPath::tangent(size_t index) const {
+    const size_t before = index > 0 ? index - 1 : index;
+    const size_t after = index + 1 < keys.size() ? index + 1 : index;
+    if (before == after) return glm::vec3(0);
+    return (keys[after].position - keys[before].position) / (keys[after].time - keys[before].time);
+}
+
+glm::vec3 CameraPath::position(float time) const {
+    if (keys.empty()) return glm::vec3(0);
+    if (keys.size() == 1) return keys.front().position;
+    float t;
+    const size_t index = segment(time, t);
+    const float span = keys[index + 1].time - keys[index].time;
+    // cubic Hermite basis
+    const float t2 = t * t, t3 = t2 * t;
+    return (2 * t3 - 3 * t2 + 1) * keys[index].position + (t3 - 2 * t2 + t) * span * tangent(index)
+           + (-2 * t3 + 3 * t2) * keys[index + 1].position + (t3 - t2) * span * tangent(index + 1);
+}
+
+glm::mat3 CameraPath::orientation(float time) const {
+    if (keys.empty()) return glm::mat3(1);
+    if (keys.size() == 1) return glm::mat3_cast(keys.front().orientation);
+    float t;
+    const size_t index = segment(time, t);
+    return glm::mat3_cast(glm::normalize(glm::slerp(keys[index].orientation, keys[index + 1].orientation, t)));
+}
+
+glm::vec3 CameraPath::light(float time) const {
+    if (keys.empty()) return glm::vec3(0);
+    if (keys.size() == 1) return keys.front().light;
+    float t;
+    const size_t index = segment(time, t);
+    return glm::mix(keys[index].light, keys[index + 1].light, t);
+}
+
+const std::string &CameraPath::mode(float time) const {
+    static const std::string none;
+    if (keys.empty()) return none;
+    if (keys.size() == 1) return keys.front().mode;
+    float t;
+    const size_t index = segment(time, t);
+    return t >= 1 ? keys[index + 1].mode : keys[index].mode;
+}
@@ -0,0 +1,46 @@
+//
+// Created by Samuel Stephens on 19/10/2026.
+//
+
+#ifndef CAMERAPATH_H
+#define CAMERAPATH_H
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include "Recording.h"
+
+struct CameraKey {
+    float time;
+    glm::vec3 position;
+    glm::quat orientation;
+    glm::vec3 light;
+    std::string mode;
+};
+
+// A recorded camera path as keyframes that can be sampled at any time between the first and the last, so a sparse
+// recording can be played back at whatever frame rate the output wants. Positions follow a Catmull-Rom style cubic
+// through the keys (tangents from the neighbouring keys, scaled for uneven spacing), orientations are slerped, light
+// positions are interpolated linearly and the mode is the one of the key at or before the time.
+class CameraPath {
+    public:
+    CameraPath();
+    explicit CameraPath(const RecordingReader &recording);
+    void addKey(const CameraKey &key);
+    size_t size() const;
+    float duration() const;
+    glm::vec3 position(float time) const;
+    glm::mat3 orientation(float time) const;
+    glm::vec3 light(float time) const;
+    const std::string &mode(float time) const;
+
+    private:
+    std::vector<CameraKey> keys;
+    size_t segment(float time, float &fraction) const;
+    glm::vec3 tangent(size_t index) const;
+};
+
+
+
+#endif //CAMERAPATH_H
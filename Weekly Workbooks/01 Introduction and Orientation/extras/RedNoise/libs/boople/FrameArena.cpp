@@ -0,0 +1,84 @@
+//
+// Created by Samuel Stephens on 19/10/2026.
+//
+
+#include "FrameArena.h"
+#include <algorithm>
+#include <mutex>
+
+#define FRAME_ARENA_ALIGNMENT 16
+#define FRAME_ARENA_INITIAL_SIZE (256 * 1024)
+
+static std::mutex registryLock;
+static std::vector<FrameArena *> registry;
+
+static size_t aligned(size_t bytes) {
+    return (bytes + FRAME_ARENA_ALIGNMENT - 1) & ~static_cast<size_t>(FRAME_ARENA_ALIGNMENT - 1);
+}
+
+FrameArena &FrameArena::local() {
+    thread_local FrameArena arena;
+    return arena;
+}
+
+void FrameArena::resetAll() {
+    std::lock_guard<std::mutex> guard(registryLock);
+    for (auto arena : registry) {
+        arena->reset();
+    }
+}
+
+FrameArena::FrameArena() {
+    blockSize = FRAME_ARENA_INITIAL_SIZE;
+    block = new char[blockSize];
+    offset = 0;
+    overflowBytes = 0;
+    std::lock_guard<std::mutex> guard(registryLock);
+    registry.push_back(this);
+}
+
+FrameArena::~FrameArena() {
+    {
+        std::lock_guard<std::mutex> guard(registryLock);
+        registry.erase(std::remove(registry.begin(), registry.end(), this), registry.end());
+    }
+    for (auto extra : overflow) {
+        delete[] extra;
+    }
+    delete[] block;
+}
+
+void *FrameArena::allocate(size_t bytes) {
+    bytes = aligned(bytes);
+    if (offset + bytes <= blockSize) {
+        void *pointer = block + offset;
+        offset += bytes;
+        return pointer;
+    }
+    char *extra = new char[bytes];
+    overflow.push_back(extra);
+    overflowBytes += bytes;
+    return extra;
+}
+
+// Scratch buffers mostly die in the reverse order they were made, so the newest one can be handed back straight away
+void FrameArena::deallocate(void *pointer, size_t bytes) {
+    bytes = aligned(bytes);
+    if (offset >= bytes && pointer == block + offset - bytes) {
+        offset -= bytes;
+    }
+}
+
+// Frees everything, and if the frame overflowed, regrows the block so the same frame fits next time
+void FrameArena::reset() {
+    offset = 0;
+    if (overflow.empty()) return;
+    for (auto extra : overflow) {
+        delete[] extra;
+    }
+    overflow.clear();
+    delete[] block;
+    blockSize += overflowBytes;
+    block = new char[blockSize];
+    overflowBytes = 0;
+}
@@ -0,0 +1,67 @@
+//
+// Created by Samuel Stephens on 19/10/2026.
+//
+
+#ifndef FRAMEARENA_H
+#define FRAMEARENA_H
+#include <cstddef>
+#include <vector>
+
+// Per-thread bump allocator for the scratch buffers the rasteriser builds for every triangle and scanline.
+// Allocating just moves a pointer, everything is released at once when the next frame starts, and the block
+// grows to fit the busiest frame seen so far, so steady-state frames never reach the heap.
+class FrameArena {
+    public:
+    static FrameArena &local();     // the calling thread's arena
+    static void resetAll();         // call between frames, while nothing is drawing
+
+    FrameArena();
+    ~FrameArena();
+    FrameArena(const FrameArena &) = delete;
+    FrameArena &operator=(const FrameArena &) = delete;
+    void *allocate(size_t bytes);
+    void deallocate(void *pointer, size_t bytes);
+    void reset();
+
+    private:
+    char *block;
+    size_t blockSize;
+    size_t offset;
+    std::vector<char *> overflow;   // taken from the heap when the block ran out this frame
+    size_t overflowBytes;
+};
+
+// Lets standard containers draw from the calling thread's FrameArena
+template <typename T>
+class FrameAllocator {
+    public:
+    typedef T value_type;
+
+    FrameAllocator() = default;
+    template <typename U>
+    FrameAllocator(const FrameAllocator<U> &) {}
+    T *allocate(size_t n) {
+        return static_cast<T *>(FrameArena::local().allocate(n * sizeof(T)));
+    }
+    void deallocate(T *pointer, size_t n) {
+        FrameArena::local().deallocate(pointer, n * sizeof(T));
+    }
+};
+
+template <typename T, typename U>
+bool operator==(const FrameAllocator<T> &, const FrameAllocator<U> &) {
+    return true;
+}
+
+template <typename T, typename U>
+bool operator!=(const FrameAllocator<T> &, const FrameAllocator<U> &) {
+    return false;
+}
+
+// Only valid until the end of the frame it was made in
+template <typename T>
+using FrameVector = std::vector<T, FrameAllocator<T>>;
+
+
+
+#endif //FRAMEARENA_H
@@ -0,0 +1,230 @@
+//
+// Created by Samuel Stephens on 19/10/2026.
+//
+
+#include "FrameCoordinator.h"
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#ifdef _WIN32
+#include <io.h>
+#define popen _popen
+#define pclose _pclose
+#define dup _dup
+#define dup2 _dup2
+#define fdopen _fdopen
+#define STDOUT_FILENO 1
+#define STDERR_FILENO 2
+#else
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+bool writeStreamFrame(std::FILE *stream, uint32_t frame, uint32_t width, uint32_t height, const std::vector<uint32_t> &pixels) {
+    FrameStreamHeader header = {{'R', 'N', 'F', 'S'}, frame, width, height};
+    if (std::fwrite(&header, sizeof(header), 1, stream) != 1) return false;
+    if (std::fwrite(pixels.data(), sizeof(uint32_t), pixels.size(), stream) != pixels.size()) return false;
+    return std::fflush(stream) == 0;
+}
+
+// False at the end of the stream, or if what comes next isn't a whole frame
+bool readStreamFrame(std::FILE *stream, FrameStreamHeader &header, std::vector<uint32_t> &pixels) {
+    if (std::fread(&header, sizeof(header), 1, stream) != 1) return false;
+    if (std::memcmp(header.magic, "RNFS", 4) != 0) return false;
+    pixels.resize(static_cast<size_t>(header.width) * header.height);
+    return std::fread(pixels.data(), sizeof(uint32_t), pixels.size(), stream) == pixels.size();
+}
+
+#ifndef _WIN32
+// Reads exactly size bytes from fd, failing at the end of the stream or once deadline has passed
+static bool readBefore(int fd, void *data, size_t size, std::chrono::steady_clock::time_point deadline) {
+    char *into = static_cast<char *>(data);
+    while (size > 0) {
+        const long long left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+        if (left <= 0) return false;
+        pollfd readable = {fd, POLLIN, 0};
+        const int ready = poll(&readable, 1, static_cast<int>(std::min<long long>(left, INT_MAX)));
+        if (ready < 0 && errno == EINTR) continue;
+        if (ready <= 0) return false;
+        const ssize_t got = read(fd, into, size);
+        if (got < 0 && errno == EINTR) continue;
+        if (got <= 0) return false;
+        into += got;
+        size -= got;
+    }
+    return true;
+}
+#endif
+
+// For a worker: points stdout at stderr, so everything else it prints ends up there, and returns a stream onto the
+// original stdout for the frames alone
+std::FILE *claimStdoutForFrames() {
+    std::fflush(stdout);
+    const int frames = dup(STDOUT_FILENO);
+    dup2(STDERR_FILENO, STDOUT_FILENO);
+    return frames < 0 ? nullptr : fdopen(frames, "wb");
+}
+
+FrameCoordinator::FrameCoordinator(std::string command, int frames, int workers, int chunkFrames) {
+    this->command = std::move(command);
+    this->frames = frames;
+    this->workers = workers;
+    this->chunkFrames = chunkFrames;
+    this->maxAttempts = 3;
+    this->frameTimeout = 600;
+    this->busy = 0;
+    this->delivered = 0;
+    this->failed = false;
+}
+
+bool FrameCoordinator::run(const std::function<void(int frame, size_t width, size_t height, const std::vector<uint32_t> &pixels)> &deliver) {
+    queue.clear();
+    finished.clear();
+    busy = 0;
+    delivered = 0;
+    failed = false;
+    for (int first = 0; first < frames; first += chunkFrames) {
+        queue.push_back({first, std::min(first + chunkFrames, frames), 0});
+    }
+    std::vector<std::thread> threads;
+    for (int worker = 0; worker < workers; worker++) {
+        threads.emplace_back(&FrameCoordinator::work, this, worker);
+    }
+    int next = 0;
+    while (next < frames) {
+        Frame frame;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            changed.wait(lock, [&] { return failed || finished.count(next) > 0; });
+            if (failed) break;
+            frame = std::move(finished[next]);
+            finished.erase(next);
+        }
+        // delivered outside the lock, so workers can keep handing frames in while this one is written out
+        deliver(next, frame.width, frame.height, frame.pixels);
+        next++;
+        std::lock_guard<std::mutex> lock(mutex);
+        delivered = next;
+        changed.notify_all();
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    return next == frames;
+}
+
+// One worker's loop: takes ranges until there are none left (or none that could still be retried)
+void FrameCoordinator::work(int worker) {
+    while (true) {
+        FrameRange range;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            // a range out with another worker might still fail and come back, so idle workers wait for those to finish.
+            // Workers also don't run too far ahead of delivery, which bounds how many frames wait here in memory.
+            const int lookahead = 2 * workers * chunkFrames;
+            changed.wait(lock, [&] { return failed || (!queue.empty() && queue.front().first < delivered + lookahead) || (queue.empty() && busy == 0); });
+            if (failed || queue.empty()) return;
+            range = queue.front();
+            queue.pop_front();
+            busy++;
+        }
+        // only attempts that get nowhere count towards giving up, a worker that dies partway still moved things on
+        const int first = range.first;
+        const bool complete = renderRange(range);
+        range.attempts = range.first > first ? 0 : range.attempts + 1;
+        std::lock_guard<std::mutex> lock(mutex);
+        busy--;
+        if (!complete) {
+            if (range.attempts >= maxAttempts) {
+                std::cerr << "frames " << range.first << "-" << range.last - 1 << " failed " << range.attempts << " times in a row, giving up" << std::endl;
+                failed = true;
+            } else {
+                std::cerr << "worker " << worker << " failed at frame " << range.first << ", handing frames " << range.first << "-" << range.last - 1 << " out again" << std::endl;
+                // the frames it was to render hold up delivery, so they go out again first
+                queue.push_front(range);
+            }
+        }
+        changed.notify_all();
+    }
+}
+
+// Runs one worker process over range, keeping every frame it sends. Returns whether they all arrived; if not, range is
+// left starting at the first frame that didn't.
+bool FrameCoordinator::renderRange(FrameRange &range) {
+    const std::string line = command + " --frames " + std::to_string(range.first) + ":" + std::to_string(range.last) + " --worker on";
+#ifdef _WIN32
+    std::FILE *stream = popen(line.c_str(), "r");
+    if (stream == nullptr) return false;
+    FrameStreamHeader header;
+    Frame frame;
+    while (range.first < range.last && readStreamFrame(stream, header, frame.pixels)) {
+        if (static_cast<int>(header.frame) != range.first) break;
+        frame.width = header.width;
+        frame.height = header.height;
+        std::lock_guard<std::mutex> lock(mutex);
+        finished[range.first] = std::move(frame);
+        frame = Frame();
+        range.first++;
+        changed.notify_all();
+    }
+    pclose(stream);
+    return range.first == range.last;
+#else
+    int answers[2];
+    if (pipe(answers) != 0) return false;
+    // the other workers' threads fork too, and a copy of the write end in one of their processes would keep this
+    // stream from ever ending
+    fcntl(answers[0], F_SETFD, FD_CLOEXEC);
+    fcntl(answers[1], F_SETFD, FD_CLOEXEC);
+    const pid_t child = fork();
+    if (child == 0) {
+        // a group of its own, so a hung worker can be killed along with whatever its shell started
+        setpgid(0, 0);
+        dup2(answers[1], STDOUT_FILENO);
+        execl("/bin/sh", "sh", "-c", line.c_str(), static_cast<char *>(nullptr));
+        _exit(127);
+    }
+    close(answers[1]);
+    if (child < 0) {
+        close(answers[0]);
+        return false;
+    }
+    setpgid(child, child);
+    FrameStreamHeader header;
+    Frame frame;
+    bool hung = false;
+    while (range.first < range.last) {
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(frameTimeout);
+        bool arrived = readBefore(answers[0], &header, sizeof(header), deadline) && std::memcmp(header.magic, "RNFS", 4) == 0
+                && static_cast<int>(header.frame) == range.first;
+        if (arrived) {
+            frame.pixels.resize(static_cast<size_t>(header.width) * header.height);
+            arrived = readBefore(answers[0], frame.pixels.data(), frame.pixels.size() * sizeof(uint32_t), deadline);
+        }
+        if (!arrived) {
+            hung = std::chrono::steady_clock::now() >= deadline;
+            break;
+        }
+        frame.width = header.width;
+        frame.height = header.height;
+        std::lock_guard<std::mutex> lock(mutex);
+        finished[range.first] = std::move(frame);
+        frame = Frame();
+        range.first++;
+        changed.notify_all();
+    }
+    if (hung) std::cerr << "no frame from the worker on frames " << range.first << "-" << range.last - 1 << " for " << frameTimeout << " s, killing it" << std::endl;
+    // a worker that stopped short is killed too, rather than left to block on a pipe nobody reads
+    if (range.first < range.last) kill(-child, SIGKILL);
+    close(answers[0]);
+    waitpid(child, nullptr, 0);
+    return range.first == range.last;
+#endif
+}
@@ -0,0 +1,76 @@
+//
+// Created by Samuel Stephens on 19/10/2026.
+//
+
+#ifndef FRAMECOORDINATOR_H
+#define FRAMECOORDINATOR_H
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Finished frames travel from a worker to the coordinator as a FrameStreamHeader followed by width * height ARGB pixels
+struct FrameStreamHeader {
+    char magic[4];              // "RNFS"
+    uint32_t frame;
+    uint32_t width;
+    uint32_t height;
+};
+
+bool writeStreamFrame(std::FILE *stream, uint32_t frame, uint32_t width, uint32_t height, const std::vector<uint32_t> &pixels);
+bool readStreamFrame(std::FILE *stream, FrameStreamHeader &header, std::vector<uint32_t> &pixels);
+std::FILE *claimStdoutForFrames();
+
+// Frames [first, last) of a playback, and how many times in a row a worker has failed to render any of them
+struct FrameRange {
+    int first;
+    int last;
+    int attempts;
+};
+
+// Splits the frames of a playback into ranges and farms them out to worker processes, one at a time per worker, so
+// faster workers take more of them. A worker is a shell command (the renderer itself, or anything that runs it on
+// another host, like ssh) that gets " --frames FIRST:LAST --worker on" appended and streams the frames back on its
+// stdout. A range whose worker fails, stops short or goes frameTimeout seconds without sending a frame is handed out
+// again from the first frame it didn't get, and a worker that hung is killed. Frames are passed to deliver one at a
+// time in frame order, on the thread that called run.
+class FrameCoordinator {
+    public:
+    int workers;
+    int chunkFrames;            // frames per range
+    int maxAttempts;            // failures in a row on a range before the whole run gives up
+    int frameTimeout;           // seconds to wait for a worker's next frame before killing it
+
+    FrameCoordinator(std::string command, int frames, int workers, int chunkFrames);
+    bool run(const std::function<void(int frame, size_t width, size_t height, const std::vector<uint32_t> &pixels)> &deliver);
+
+    private:
+    struct Frame {
+        size_t width;
+        size_t height;
+        std::vector<uint32_t> pixels;
+    };
+
+    std::string command;
+    int frames;
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<FrameRange> queue;
+    std::map<int, Frame> finished;  // frames that came in ahead of the next one to deliver
+    int busy;                       // ranges out with workers right now
+    int delivered;                  // frames passed to deliver so far
+    bool failed;
+
+    void work(int worker);
+    bool renderRange(FrameRange &range);
+};
+
+
+
+#endif //FRAMECOORDINATOR_H
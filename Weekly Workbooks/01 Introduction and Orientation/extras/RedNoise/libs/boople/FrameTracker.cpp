@@ -0,0 +1,46 @@
+//
+// Created by Samuel Stephens on 19/10/2026.
+//
+
+#include "FrameTracker.h"
+
+FrameTracker::FrameTracker() {
+    stale = true;
+    shadingStale = false;
+    cameraRevision = 0;
+    lightRevision = 0;
+    sceneRevision = 0;
+}
+
+// Compares against the revisions of the previous call and records the new ones
+Invalidation FrameTracker::update(const Camera &camera, const LightSet &lights, unsigned long sceneRevision) {
+    Invalidation result = Invalidation::NONE;
+    if (stale || camera.revision != cameraRevision || sceneRevision != this->sceneRevision) {
+        result = Invalidation::VISIBILITY;
+    } else if (camera.mode != mode) {
+        // switching between raytraced modes only changes how the same primary hits are shaded
+        result = camera.raytraced() && Camera::raytracedMode(mode) ? Invalidation::SHADING : Invalidation::VISIBILITY;
+    } else if (lights.revision() != lightRevision) {
+        // the rasterised modes are unlit, so moving the light leaves them untouched
+        result = camera.raytraced() ? Invalidation::SHADING : Invalidation::NONE;
+    } else if (shadingStale) {
+        result = Invalidation::SHADING;
+    }
+    stale = false;
+    shadingStale = false;
+    cameraRevision = camera.revision;
+    mode = camera.mode;
+    lightRevision = lights.revision();
+    this->sceneRevision = sceneRevision;
+    return result;
+}
+
+// Forces the next update to report a full redraw, e.g. after something drew straight into the window
+void FrameTracker::invalidate() {
+    stale = true;
+}
+
+// Forces the next update to report at least a reshade, for settings that change shading but not visibility
+void FrameTracker::reshade() {
+    shadingStale = true;
+}
@@ -0,0 +1,36 @@
+//
+// Created by Samuel Stephens on 19/10/2026.
+//
+
+#ifndef FRAMETRACKER_H
+#define FRAMETRACKER_H
+#include "Camera.h"
+#include "LightSet.h"
+
+// How much of the last frame is out of date
+enum class Invalidation {
+    NONE,       // nothing changed, the last frame can be shown again
+    SHADING,    // only lighting changed, primary visibility is still valid
+    VISIBILITY  // the view or scene changed, everything must be redrawn
+};
+
+// Remembers the camera, lights and scene revisions the last frame was drawn with
+class FrameTracker {
+    public:
+    FrameTracker();
+    Invalidation update(const Camera &camera, const LightSet &lights, unsigned long sceneRevision);
+    void invalidate();
+    void reshade();
+
+    private:
+    bool stale;
+    bool shadingStale;
+    unsigned long cameraRevision;
+    std::string mode;
+    unsigned long lightRevision;
+    unsigned long sceneRevision;
+};
+
+
+
+#endif //FRAMETRACKER_H
@@ -0,0 +1,41 @@
+//
+// Created by Samuel Stephens on 19/10/2026.
+//
+
+#include "GBuffer.h"
+
+GBuffer::GBuffer() {
+    width = 0;
+    height = 0;
+    complete = false;
+    supersampledPixels = 0;
+    scene = nullptr;
+}
+
+GBuffer::GBuffer(size_t width, size_t height) {
+    this->width = width;
+    this->height = height;
+    this->samples = std::vector<GBufferSample>(width * height);
+    this->complete = false;
+    this->supersampledPixels = 0;
+    this->scene = nullptr;
+}
+
+GBufferSample &GBuffer::at(size_t x, size_t y) {
+    return samples[y * width + x];
+}
+
+// Samples only make sense against the triangle list they were traced with, so switching lists drops them
+void GBuffer::useScene(const std::vector<ModelTriangle> &triangles) {
+    if (scene != &triangles) {
+        scene = &triangles;
+        invalidate();
+    }
+}
+
+void GBuffer::invalidate() {
+    complete = false;
+    for (auto &sample : samples) {
+        sample.valid = false;
+    }
+}
@@ -0,0 +1,45 @@
+//
+// Created by Samuel Stephens on 19/10/2026.
+//
+
+#ifndef GBUFFER_H
+#define GBUFFER_H
+#include <vector>
+#include <glm/glm.hpp>
+#include <sdw/Colour.h>
+#include <sdw/ModelTriangle.h>
+
+// What the primary ray through one pixel hit
+struct GBufferSample {
+    bool valid = false;             // traced for the current view
+    bool hit = false;
+    size_t triangleIndex = 0;       // index into the triangles the buffer was traced against
+    glm::vec3 position{};
+    float depth = 0;                // distance from the camera to the hit
+    glm::vec3 normal{};
+    glm::vec3 barycentric{};
+    Colour colour{};                // the triangle's material colour
+};
+
+// Per-pixel cache of primary visibility, so lighting-only changes can be reshaded without retracing the view
+class GBuffer {
+    public:
+    size_t width;
+    size_t height;
+    std::vector<GBufferSample> samples;
+    bool complete;                  // every sample was filled in one go (by the visibility rasteriser)
+    int supersampledPixels;         // edge pixels that adaptive anti-aliasing traced extra rays for in the last frame
+
+    GBuffer();
+    explicit GBuffer(size_t width, size_t height);
+    GBufferSample &at(size_t x, size_t y);
+    void useScene(const std::vector<ModelTriangle> &triangles);
+    void invalidate();
+
+    private:
+    const std::vector<ModelTriangle> *scene;
+};
+
+
+
+#endif //GBUFFER_H
@@ -0,0 +1,50 @@
+//
+// Created by Samuel Stephens on 19/10/2026.
+//
+
+#include "GoldenImage.h"
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <limits>
+#include <sdw/TextureMap.h>
+
+GoldenImage::GoldenImage() {
+    tolerance = 8;
+    minPSNR = 40;
+    maxMismatched = 0.001;
+}
+
+GoldenImage::GoldenImage(int tolerance, double minPSNR, double maxMismatched) {
+    this->tolerance = tolerance;
+    this->minPSNR = minPSNR;
+    this->maxMismatched = maxMismatched;
+}
+
+GoldenResult GoldenImage::compare(DrawingWindow &window, const std::string &filename) const {
+    GoldenResult result;
+    if (!std::ifstream(filename).good()) return result;
+    TextureMap golden = TextureMap(filename);
+    if (golden.width != window.width || golden.height != window.height) return result;
+    result.loaded = true;
+
+    double squaredError = 0;
+    for (size_t y = 0; y < window.height; y++) {
+        for (size_t x = 0; x < window.width; x++) {
+            uint32_t actual = window.getPixelColour(x, y);
+            uint32_t expected = golden.pixels[y * golden.width + x];
+            int worst = 0;
+            for (int shift = 0; shift <= 16; shift += 8) {
+                int difference = std::abs(static_cast<int>((actual >> shift) & 0xFF) - static_cast<int>((expected >> shift) & 0xFF));
+                squaredError += difference * difference;
+                worst = std::max(worst, difference);
+            }
+            if (worst > tolerance) result.mismatchedPixels++;
+            result.maxDifference = std::max(result.maxDifference, worst);
+        }
+    }
+    double mse = squaredError / (3.0 * window.width * window.height);
+    result.psnr = mse == 0 ? std::numeric_limits<double>::infinity() : 10 * std::log10(255.0 * 255.0 / mse);
+    result.passed = result.psnr >= minPSNR && result.mismatchedPixels <= maxMismatched * window.width * window.height;
+    return result;
+}
@@ -0,0 +1,32 @@
+//
+// Created by Samuel Stephens on 19/10/2026.
+//
+
+#ifndef GOLDENIMAGE_H
+#define GOLDENIMAGE_H
+#include <string>
+#include <sdw/DrawingWindow.h>
+
+// Result of comparing a rendered frame against its stored reference image
+struct GoldenResult {
+    bool loaded = false;
+    size_t mismatchedPixels = 0;
+    int maxDifference = 0;
+    double psnr = 0;
+    bool passed = false;
+};
+
+class GoldenImage {
+    public:
+    int tolerance;          // largest per-channel difference that still counts as a matching pixel
+    double minPSNR;         // frames below this PSNR (dB) fail
+    double maxMismatched;   // fraction of pixels allowed to exceed the tolerance
+
+    GoldenImage();
+    explicit GoldenImage(int tolerance, double minPSNR, double maxMismatched);
+    GoldenResult compare(DrawingWindow &window, const std::string &filename) const;
+};
+
+
+
+#endif //GOLDENIMAGE_H
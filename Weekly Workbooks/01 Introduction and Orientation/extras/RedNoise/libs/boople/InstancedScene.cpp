@@ -0,0 +1,213 @@
+//
+// Created by Samuel Stephens on 19/10/2026.
+//
+
+#include "InstancedScene.h"
+#include <cmath>
+#include <limits>
+
+// Möller-Trumbore: the distance along the ray to the triangle, or infinity if it misses
+static float intersectTriangle(const ModelTriangle &triangle, const glm::vec3 &origin, const glm::vec3 &direction, float &u, float &v) {
+    const float miss = std::numeric_limits<float>::infinity();
+    glm::vec3 e0 = triangle.vertices[1] - triangle.vertices[0];
+    glm::vec3 e1 = triangle.vertices[2] - triangle.vertices[0];
+    glm::vec3 p = cross(direction, e1);
+    float determinant = dot(e0, p);
+    if (std::abs(determinant) < 1e-12f) return miss;
+    float inverse = 1 / determinant;
+    glm::vec3 s = origin - triangle.vertices[0];
+    u = dot(s, p) * inverse;
+    if (u < 0 || u > 1) return miss;
+    glm::vec3 q = cross(s, e0);
+    v = dot(direction, q) * inverse;
+    if (v < 0 || u + v > 1) return miss;
+    float t = dot(e1, q) * inverse;
+    return t > 0 ? t : miss;
+}
+
+// Takes ownership of the triangles, which should be in the mesh's object space, and builds their BVH. Returns -1 and
+// keeps nothing if there are no triangles, since a mesh without a BVH has no box to place its instances with.
+int InstancedScene::addMesh(std::vector<ModelTriangle> triangles) {
+    if (triangles.empty()) return -1;
+    Mesh mesh = Mesh();
+    mesh.triangles = std::move(triangles);
+    mesh.bvh.build(triangleBounds(mesh.triangles), meshMethod);
+    meshes.push_back(std::move(mesh));
+    return static_cast<int>(meshes.size()) - 1;
+}
+
+// Places the mesh in the world. Call buildTopLevel once every instance is in. Returns -1 and places nothing if there
+// is no such mesh (as when addMesh was given an empty one).
+int InstancedScene::addInstance(int mesh, const glm::mat4 &toWorld) {
+    if (mesh < 0 || mesh >= static_cast<int>(meshes.size())) return -1;
+    Instance instance = Instance();
+    instance.mesh = mesh;
+    instances.push_back(instance);
+    setTransform(static_cast<int>(instances.size()) - 1, toWorld);
+    return static_cast<int>(instances.size()) - 1;
+}
+
+void InstancedScene::setTransform(int instance, const glm::mat4 &toWorld) {
+    Instance &placed = instances[instance];
+    placed.toWorld = toWorld;
+    placed.toObject = glm::inverse(toWorld);
+    placed.normalToWorld = glm::transpose(glm::mat3(placed.toObject));
+    placeBounds(placed);
+}
+
+// Catches the mesh's BVH and normals up with vertices that were moved in place, along with the world boxes of its instances
+void InstancedScene::refitMesh(int mesh) {
+    Mesh &moved = meshes[mesh];
+    std::vector<BoundingBox> bounds(moved.triangles.size());
+    for (size_t index = 0; index < moved.triangles.size(); index++) {
+        ModelTriangle &triangle = moved.triangles[index];
+        triangle.normal = normalize(cross(triangle.vertices[0] - triangle.vertices[1], triangle.vertices[0] - triangle.vertices[2]));
+        for (const auto &vertex : triangle.vertices) bounds[index].grow(vertex);
+    }
+    moved.bvh.refit(bounds);
+    for (auto &instance : instances) {
+        if (instance.mesh == mesh) placeBounds(instance);
+    }
+}
+
+void InstancedScene::buildTopLevel() {
+    std::vector<BoundingBox> bounds(instances.size());
+    for (size_t index = 0; index < instances.size(); index++) bounds[index] = instances[index].bounds;
+    topLevel.build(bounds, topLevelMethod);
+}
+
+// Builds every mesh's BVH again from scratch with meshMethod, then the top level with topLevelMethod
+void InstancedScene::rebuild() {
+    for (auto &mesh : meshes) mesh.bvh.build(triangleBounds(mesh.triangles), meshMethod);
+    for (auto &instance : instances) placeBounds(instance);
+    buildTopLevel();
+}
+
+// The closest hit along the ray from origin. The direction is carried into each instance unnormalised, so distances
+// along it mean the same thing in every object space and can be compared directly.
+bool InstancedScene::intersect(const glm::vec3 &origin, const glm::vec3 &direction, InstanceHit &hit) const {
+    float nearest = std::numeric_limits<float>::max();
+    hit.instance = -1;
+    topLevel.traverse(origin, direction, nearest, [&](int index, float &nearestInstance) {
+        const Instance &instance = instances[index];
+        const Mesh &mesh = meshes[instance.mesh];
+        const glm::vec3 localOrigin = glm::vec3(instance.toObject * glm::vec4(origin, 1));
+        const glm::vec3 localDirection = glm::mat3(instance.toObject) * direction;
+        mesh.bvh.traverse(localOrigin, localDirection, nearestInstance, [&](int triangle, float &nearestTriangle) {
+            float u, v;
+            float t = intersectTriangle(mesh.triangles[triangle], localOrigin, localDirection, u, v);
+            if (t < nearestTriangle) {
+                nearestTriangle = t;
+                hit.instance = index;
+                hit.triangle = triangle;
+            }
+            return false;
+        });
+        return false;
+    });
+    return finishHit(origin, direction, nearest, hit);
+}
+
+// Whether anything lies on the segment between the two points, stopping at the first thing found
+bool InstancedScene::occluded(const glm::vec3 &from, const glm::vec3 &to) const {
+    const glm::vec3 direction = to - from;
+    float nearest = 0.999f;
+    return topLevel.traverse(from, direction, nearest, [&](int index, float &) {
+        const Instance &instance = instances[index];
+        const Mesh &mesh = meshes[instance.mesh];
+        const glm::vec3 localOrigin = glm::vec3(instance.toObject * glm::vec4(from, 1));
+        const glm::vec3 localDirection = glm::mat3(instance.toObject) * direction;
+        float limit = 0.999f;
+        return mesh.bvh.traverse(localOrigin, localDirection, limit, [&](int triangle, float &) {
+            float u, v;
+            float t = intersectTriangle(mesh.triangles[triangle], localOrigin, localDirection, u, v);
+            return t > 0.001f && t < 0.999f;
+        });
+    });
+}
+
+// What intersect finds, by testing every triangle of every instance instead of walking the BVHs. Far too slow to render
+// with; it's what the golden harness checks the walk against.
+bool InstancedScene::intersectEveryTriangle(const glm::vec3 &origin, const glm::vec3 &direction, InstanceHit &hit) const {
+    float nearest = std::numeric_limits<float>::max();
+    hit.instance = -1;
+    for (size_t index = 0; index < instances.size(); index++) {
+        const Instance &instance = instances[index];
+        const Mesh &mesh = meshes[instance.mesh];
+        const glm::vec3 localOrigin = glm::vec3(instance.toObject * glm::vec4(origin, 1));
+        const glm::vec3 localDirection = glm::mat3(instance.toObject) * direction;
+        for (size_t triangle = 0; triangle < mesh.triangles.size(); triangle++) {
+            float u, v;
+            float t = intersectTriangle(mesh.triangles[triangle], localOrigin, localDirection, u, v);
+            if (t < nearest) {
+                nearest = t;
+                hit.instance = static_cast<int>(index);
+                hit.triangle = static_cast<int>(triangle);
+            }
+        }
+    }
+    return finishHit(origin, direction, nearest, hit);
+}
+
+// What occluded finds, the same way
+bool InstancedScene::occludedByAnyTriangle(const glm::vec3 &from, const glm::vec3 &to) const {
+    const glm::vec3 direction = to - from;
+    for (const auto &instance : instances) {
+        const Mesh &mesh = meshes[instance.mesh];
+        const glm::vec3 localOrigin = glm::vec3(instance.toObject * glm::vec4(from, 1));
+        const glm::vec3 localDirection = glm::mat3(instance.toObject) * direction;
+        for (const auto &triangle : mesh.triangles) {
+            float u, v;
+            float t = intersectTriangle(triangle, localOrigin, localDirection, u, v);
+            if (t > 0.001f && t < 0.999f) return true;
+        }
+    }
+    return false;
+}
+
+// Fills in the rest of hit once the closest triangle along the ray is known
+bool InstancedScene::finishHit(const glm::vec3 &origin, const glm::vec3 &direction, float distance, InstanceHit &hit) const {
+    if (hit.instance < 0) return false;
+    const Instance &instance = instances[hit.instance];
+    hit.distance = distance;
+    hit.point = origin + distance * direction;
+    hit.normal = normalize(instance.normalToWorld * meshes[instance.mesh].triangles[hit.triangle].normal);
+    return true;
+}
+
+std::vector<BoundingBox> InstancedScene::triangleBounds(const std::vector<ModelTriangle> &triangles) {
+    std::vector<BoundingBox> bounds(triangles.size());
+    for (size_t index = 0; index < triangles.size(); index++) {
+        for (const auto &vertex : triangles[index].vertices) bounds[index].grow(vertex);
+    }
+    return bounds;
+}
+
+// Carries the corners of the mesh's box into world space and boxes them
+void InstancedScene::placeBounds(Instance &instance) const {
+    const BoundingBox &local = meshes[instance.mesh].bvh.nodes[0].bounds;
+    instance.bounds = BoundingBox();
+    for (int corner = 0; corner < 8; corner++) {
+        glm::vec3 point = glm::vec3(corner & 1 ? local.upper.x : local.lower.x, corner & 2 ? local.upper.y : local.lower.y, corner & 4 ? local.upper.z : local.lower.z);
+        instance.bounds.grow(glm::vec3(instance.toWorld * glm::vec4(point, 1)));
+    }
+}
+
+size_t InstancedScene::uniqueTriangles() const {
+    size_t total = 0;
+    for (const auto &mesh : meshes) total += mesh.triangles.size();
+    return total;
+}
+
+// How many triangles the scene would hold if every instance were flattened into world space
+size_t InstancedScene::instancedTriangles() const {
+    size_t total = 0;
+    for (const auto &instance : instances) total += meshes[instance.mesh].triangles.size();
+    return total;
+}
+
+size_t InstancedScene::bytes() const {
+    size_t total = instances.capacity() * sizeof(Instance) + topLevel.bytes();
+    for (const auto &mesh : meshes) total += mesh.triangles.capacity() * sizeof(ModelTriangle) + mesh.bvh.bytes();
+    return total;
+}
@@ -0,0 +1,72 @@
+//
+// Created by Samuel Stephens on 19/10/2026.
+//
+
+#ifndef INSTANCEDSCENE_H
+#define INSTANCEDSCENE_H
+#include <cstddef>
+#include <vector>
+#include <glm/glm.hpp>
+#include <sdw/ModelTriangle.h>
+#include "BVH.h"
+
+// Geometry stored once, in its own object space, with the bottom level BVH over its triangles
+struct Mesh {
+    std::vector<ModelTriangle> triangles;
+    BVH bvh;
+};
+
+// One placement of a mesh in the world
+struct Instance {
+    int mesh;
+    glm::mat4 toWorld;
+    glm::mat4 toObject;
+    glm::mat3 normalToWorld;
+    BoundingBox bounds;             // the mesh's box carried into world space
+};
+
+// The closest thing a ray hit, in world space
+struct InstanceHit {
+    float distance;
+    int instance;
+    int triangle;                   // into the instance's mesh
+    glm::vec3 point;
+    glm::vec3 normal;
+};
+
+// A scene made of instances of shared meshes, so an object placed a thousand times costs its triangles once plus a
+// transform per placement. Rays walk a top level BVH over the instances' world boxes, then each instance's mesh BVH
+// with the ray carried into the mesh's object space.
+// For animation, a mesh whose vertices were moved in place is refit rather than rebuilt, and instances are moved with
+// setTransform; either way buildTopLevel has to run again before the next frame is traced.
+class InstancedScene {
+    public:
+    std::vector<Mesh> meshes;
+    std::vector<Instance> instances;
+    BVH topLevel;
+    BVHMethod meshMethod = BVHMethod::SAH;         // built once and refit after, so worth the best tree
+    BVHMethod topLevelMethod = BVHMethod::LBVH;    // rebuilt every frame, so quick to build beats quick to trace
+
+    int addMesh(std::vector<ModelTriangle> triangles);
+    int addInstance(int mesh, const glm::mat4 &toWorld);
+    void setTransform(int instance, const glm::mat4 &toWorld);
+    void refitMesh(int mesh);
+    void buildTopLevel();
+    void rebuild();
+    bool intersect(const glm::vec3 &origin, const glm::vec3 &direction, InstanceHit &hit) const;
+    bool occluded(const glm::vec3 &from, const glm::vec3 &to) const;
+    bool intersectEveryTriangle(const glm::vec3 &origin, const glm::vec3 &direction, InstanceHit &hit) const;
+    bool occludedByAnyTriangle(const glm::vec3 &from, const glm::vec3 &to) const;
+    size_t uniqueTriangles() const;
+    size_t instancedTriangles() const;
+    size_t bytes() const;
+
+    private:
+    static std::vector<BoundingBox> triangleBounds(const std::vector<ModelTriangle> &triangles);
+    void placeBounds(Instance &instance) const;
+    bool finishHit(const glm::vec3 &origin, const glm::vec3 &direction, float distance, InstanceHit &hit) const;
+};
+
+
+
+#endif //INSTANCEDSCENE_H
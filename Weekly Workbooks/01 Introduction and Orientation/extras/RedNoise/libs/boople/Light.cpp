@@ -2,13 +2,56 @@
 // Created by Samuel Stephens on 17/11/2024.
 //
 #include "Light.h"
+#include <algorithm>
+#include <glm/glm.hpp>
+#include <cmath>
+#include <limits>
 
 Light::Light() {
     position = glm::vec3(0, 0.8, 0);
     intensity = 1;
+    range = std::numeric_limits<float>::infinity();
 }
 
 Light::Light(glm::vec3 position, float intensity) {
     this->position = position;
     this->intensity = intensity;
+    this->range = std::numeric_limits<float>::infinity();
+}
+
+void Light::move(glm::vec3 delta) {
+    position += delta;
+    revision++;
+}
+
+void Light::nextShape() {
+    shape = shape == LightShape::POINT ? LightShape::QUAD : shape == LightShape::QUAD ? LightShape::SPHERE : LightShape::POINT;
+    revision++;
+}
+
+bool Light::area() const {
+    return shape != LightShape::POINT;
+}
+
+// How much of the light still reaches point: 1 close up, easing down to 0 at range, so there is no hard edge where it ends
+float Light::fade(glm::vec3 point) const {
+    glm::vec3 offset = position - point;
+    float ratio = glm::dot(offset, offset) / (range * range);
+    if (ratio >= 1) return 0;
+    float edge = 1 - ratio * ratio;
+    return edge * edge;
+}
+
+// Maps (s, t) in the unit square onto the light's surface, uniformly by area
+glm::vec3 Light::samplePoint(float s, float t) const {
+    if (shape == LightShape::QUAD) {
+        return position + glm::vec3((2 * s - 1) * size, 0, (2 * t - 1) * size);
+    }
+    if (shape == LightShape::SPHERE) {
+        float z = 1 - 2 * s;
+        float r = std::sqrt(std::max(0.0f, 1 - z * z));
+        float phi = 2 * 3.14159265f * t;
+        return position + size * glm::vec3(r * std::cos(phi), r * std::sin(phi), z);
+    }
+    return position;
 }
\ No newline at end of file
@@ -7,13 +7,25 @@
 #include <glm/detail/type_vec.hpp>
 #include <glm/detail/type_vec3.hpp>
 
+// POINT gives hard shadows, the area shapes are sampled for soft ones
+enum class LightShape {POINT, QUAD, SPHERE};
+
 class Light {
     public:
     glm::vec3 position;
     float intensity;
+    LightShape shape = LightShape::POINT;
+    float size = 0.1;           // sphere radius, or half the side of the (horizontal, square) quad
+    float range;                // light fades out smoothly to nothing at this distance
+    unsigned long revision = 0; // bumped on every move or change of shape
 
     Light();
     explicit Light(glm::vec3 position, float intensity);
+    void move(glm::vec3 delta);
+    void nextShape();
+    bool area() const;
+    float fade(glm::vec3 point) const;
+    glm::vec3 samplePoint(float s, float t) const;
 };
 
 
@@ -0,0 +1,80 @@
+//
+// Created by Samuel Stephens on 19/10/2026.
+//
+
+#include "LightSet.h"
+#include <algorithm>
+#include <glm/glm.hpp>
+
+// Starts with just the default ceiling light
+LightSet::LightSet() {
+    lights = {Light()};
+    selected = 0;
+    listRevision = 0;
+}
+
+LightSet::LightSet(std::vector<Light> lights) {
+    this->lights = std::move(lights);
+    this->selected = 0;
+    this->listRevision = 0;
+}
+
+Light &LightSet::current() {
+    return lights[selected];
+}
+
+// Adds a light and selects it, so it can be moved into place straight away
+void LightSet::add(const Light &light) {
+    lights.push_back(light);
+    selected = lights.size() - 1;
+    listRevision++;
+}
+
+void LightSet::selectNext() {
+    selected = (selected + 1) % lights.size();
+}
+
+// Changes whenever any light moves or changes shape, or the list itself changes
+unsigned long LightSet::revision() const {
+    unsigned long sum = listRevision;
+    for (const auto &light : lights) {
+        sum += light.revision;
+    }
+    return sum;
+}
+
+// Rough unshadowed contribution of a light at a point, with the same clamped falloff and range fade as the shading,
+// so zero when the point is out of the light's range
+float LightSet::weight(size_t index, glm::vec3 point) const {
+    const Light &light = lights[index];
+    float fade = light.fade(point);
+    if (fade <= 0) return 0;
+    glm::vec3 offset = light.position - point;
+    return light.intensity * std::min(1.0f, 1 / glm::dot(offset, offset)) * fade;
+}
+
+// Picks a light with probability proportional to its weight, using u in [0,1). Returns lights.size() when every light
+// is out of range.
+size_t LightSet::choose(glm::vec3 point, float u, float &probability) const {
+    float total = 0;
+    for (size_t i = 0; i < lights.size(); i++) {
+        total += weight(i, point);
+    }
+    probability = 0;
+    if (total <= 0) return lights.size();
+    float target = u * total;
+    size_t last = lights.size();
+    for (size_t i = 0; i < lights.size(); i++) {
+        float w = weight(i, point);
+        if (w <= 0) continue;
+        last = i;
+        if (target < w) {
+            probability = w / total;
+            return i;
+        }
+        target -= w;
+    }
+    // rounding left the target just past the end
+    probability = weight(last, point) / total;
+    return last;
+}
@@ -0,0 +1,31 @@
+//
+// Created by Samuel Stephens on 19/10/2026.
+//
+
+#ifndef LIGHTSET_H
+#define LIGHTSET_H
+#include <vector>
+#include "Light.h"
+
+// Every light in the scene, plus which one the keyboard is moving
+class LightSet {
+    public:
+    std::vector<Light> lights;
+    size_t selected;
+
+    LightSet();
+    explicit LightSet(std::vector<Light> lights);
+    Light &current();
+    void add(const Light &light);
+    void selectNext();
+    unsigned long revision() const;
+    float weight(size_t index, glm::vec3 point) const;
+    size_t choose(glm::vec3 point, float u, float &probability) const;
+
+    private:
+    unsigned long listRevision;
+};
+
+
+
+#endif //LIGHTSET_H
@@ -0,0 +1,52 @@
+//
+// Created by Samuel Stephens on 19/10/2026.
+//
+
+#include "ProgressiveRefinement.h"
+
+ProgressiveRefinement::ProgressiveRefinement() {
+    enabled = false;
+    maxStride = 8;
+    stride = maxStride;
+    lightRevision = 0;
+}
+
+ProgressiveRefinement::ProgressiveRefinement(int maxStride) {
+    this->enabled = false;
+    this->maxStride = maxStride;
+    this->stride = maxStride;
+    this->lightRevision = 0;
+}
+
+// Restarts the refinement if the camera, mode or lights differ from the last frame; returns true on restart
+bool ProgressiveRefinement::update(const Camera &camera, const LightSet &lights) {
+    if (camera.position == cameraPosition && camera.orientation == cameraOrientation && camera.mode == cameraMode && lights.revision() == lightRevision) {
+        return false;
+    }
+    cameraPosition = camera.position;
+    cameraOrientation = camera.orientation;
+    cameraMode = camera.mode;
+    lightRevision = lights.revision();
+    restart();
+    return true;
+}
+
+// Once the stride-1 pass is done every pixel is at full resolution
+bool ProgressiveRefinement::finished() const {
+    return stride < 1;
+}
+
+// A pixel is traced in the first pass it lands on the stride grid, and never again until a restart
+bool ProgressiveRefinement::shouldTrace(int x, int y) const {
+    if (x % stride != 0 || y % stride != 0) return false;
+    if (stride == maxStride) return true;
+    return x % (stride * 2) != 0 || y % (stride * 2) != 0;
+}
+
+void ProgressiveRefinement::advance() {
+    stride /= 2;
+}
+
+void ProgressiveRefinement::restart() {
+    stride = maxStride;
+}
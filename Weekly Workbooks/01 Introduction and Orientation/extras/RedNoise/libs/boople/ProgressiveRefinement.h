@@ -0,0 +1,37 @@
+//
+// Created by Samuel Stephens on 19/10/2026.
+//
+
+#ifndef PROGRESSIVEREFINEMENT_H
+#define PROGRESSIVEREFINEMENT_H
+#include <string>
+#include <glm/glm.hpp>
+#include "Camera.h"
+#include "LightSet.h"
+
+// Tracks which strided pass of a progressive raytrace is due next.
+// Each pass halves the stride until every pixel has been traced; any change to the view restarts from the coarsest pass.
+class ProgressiveRefinement {
+    public:
+    bool enabled;
+    int maxStride;
+    int stride;
+
+    ProgressiveRefinement();
+    explicit ProgressiveRefinement(int maxStride);
+    bool update(const Camera &camera, const LightSet &lights);
+    bool finished() const;
+    bool shouldTrace(int x, int y) const;
+    void advance();
+    void restart();
+
+    private:
+    glm::vec3 cameraPosition;
+    glm::mat3 cameraOrientation;
+    std::string cameraMode;
+    unsigned long lightRevision;
+};
+
+
+
+#endif //PROGRESSIVEREFINEMENT_H
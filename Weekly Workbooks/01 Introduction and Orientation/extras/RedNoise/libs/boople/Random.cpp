@@ -0,0 +1,33 @@
+//
+// Created by Samuel Stephens on 19/10/2026.
+//
+
+#include "Random.h"
+
+Random::Random(uint32_t seed) {
+    // xorshift gets stuck on zero
+    state = seed == 0 ? 0x9E3779B9u : seed;
+}
+
+// Hashes a pixel and frame number into a well mixed seed
+uint32_t Random::seedFor(int x, int y, uint32_t frame) {
+    uint32_t hash = static_cast<uint32_t>(x) * 73856093u ^ static_cast<uint32_t>(y) * 19349663u ^ frame * 83492791u;
+    hash ^= hash >> 16;
+    hash *= 0x7feb352du;
+    hash ^= hash >> 15;
+    hash *= 0x846ca68bu;
+    hash ^= hash >> 16;
+    return hash;
+}
+
+uint32_t Random::nextInt() {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+// Uniform in [0, 1)
+float Random::next() {
+    return static_cast<float>(nextInt() >> 8) / static_cast<float>(1u << 24);
+}
@@ -0,0 +1,22 @@
+//
+// Created by Samuel Stephens on 19/10/2026.
+//
+
+#ifndef RANDOM_H
+#define RANDOM_H
+#include <cstdint>
+
+// Small xorshift generator so each pixel can have its own cheap, repeatable random sequence
+class Random {
+    public:
+    uint32_t state;
+
+    explicit Random(uint32_t seed);
+    static uint32_t seedFor(int x, int y, uint32_t frame);
+    uint32_t nextInt();
+    float next();
+};
+
+
+
+#endif //RANDOM_H
@@ -0,0 +1,28 @@
+//
+// Created by Samuel Stephens on 19/10/2026.
+//
+
+#include "RayStack.h"
+
+RayStack::RayStack() {
+    size = 0;
+}
+
+bool RayStack::empty() const {
+    return size == 0;
+}
+
+bool RayStack::full() const {
+    return size == RAY_STACK_SIZE;
+}
+
+// Returns false (and drops the ray) when the stack is already full
+bool RayStack::push(const SecondaryRay &ray) {
+    if (full()) return false;
+    rays[size++] = ray;
+    return true;
+}
+
+SecondaryRay RayStack::pop() {
+    return rays[--size];
+}
@@ -0,0 +1,37 @@
+//
+// Created by Samuel Stephens on 19/10/2026.
+//
+
+#ifndef RAYSTACK_H
+#define RAYSTACK_H
+#include <array>
+#include <glm/glm.hpp>
+
+#define RAY_STACK_SIZE 32
+
+// A mirror or glass continuation still waiting to be traced
+struct SecondaryRay {
+    glm::vec3 origin;
+    glm::vec3 direction;    // world space, not yet flipped for findClosestIntersection
+    glm::vec3 throughput;   // how much of whatever this ray finds reaches the pixel
+    int depth;              // number of bounces taken to get here
+    bool inside;            // travelling through glass
+};
+
+// Fixed capacity stack of secondary rays, so following bounces needs neither recursion nor the heap
+class RayStack {
+    public:
+    RayStack();
+    bool empty() const;
+    bool full() const;
+    bool push(const SecondaryRay &ray);
+    SecondaryRay pop();
+
+    private:
+    std::array<SecondaryRay, RAY_STACK_SIZE> rays;
+    int size;
+};
+
+
+
+#endif //RAYSTACK_H
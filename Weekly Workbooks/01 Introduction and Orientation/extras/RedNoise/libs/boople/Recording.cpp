@@ -0,0 +1,179 @@
+//
+// Created by Samuel Stephens on 19/10/2026.
+//
+
+#include "Recording.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// the file layout is the struct layout, so it mustn't pick up any padding
+static_assert(sizeof(RecordingHeader) == 16 && sizeof(PoseRecord) == 80, "recording records must be tightly packed");
+
+glm::vec3 PoseRecord::cameraPosition() const {
+    return {position[0], position[1], position[2]};
+}
+
+glm::mat3 PoseRecord::cameraOrientation() const {
+    glm::mat3 matrix;
+    for (int column = 0; column < 3; column++) {
+        matrix[column] = glm::vec3(orientation[column * 3], orientation[column * 3 + 1], orientation[column * 3 + 2]);
+    }
+    return matrix;
+}
+
+glm::vec3 PoseRecord::lightPosition() const {
+    return {light[0], light[1], light[2]};
+}
+
+std::string PoseRecord::modeName() const {
+    return std::string(mode, strnlen(mode, sizeof(mode)));
+}
+
+RecordingWriter::RecordingWriter() {
+    file = nullptr;
+    written = 0;
+}
+
+RecordingWriter::~RecordingWriter() {
+    close();
+}
+
+// Starts a new recording, replacing anything already at filename
+bool RecordingWriter::open(const std::string &filename, uint32_t flags) {
+    close();
+    file = std::fopen(filename.c_str(), "wb");
+    if (file == nullptr) return false;
+    RecordingHeader header = {{'R', 'N', 'R', 'C'}, RECORDING_VERSION, sizeof(PoseRecord), flags};
+    std::fwrite(&header, sizeof(header), 1, file);
+    buffer.reserve(256);
+    written = 0;
+    return true;
+}
+
+bool RecordingWriter::isOpen() const {
+    return file != nullptr;
+}
+
+void RecordingWriter::append(float time, glm::vec3 position, glm::mat3 orientation, glm::vec3 light, const std::string &mode) {
+    if (file == nullptr) return;
+    PoseRecord record = PoseRecord();
+    record.time = time;
+    for (int k = 0; k < 3; k++) {
+        record.position[k] = position[k];
+        record.light[k] = light[k];
+        for (int row = 0; row < 3; row++) record.orientation[k * 3 + row] = orientation[k][row];
+    }
+    std::strncpy(record.mode, mode.c_str(), sizeof(record.mode) - 1);
+    buffer.push_back(record);
+    if (buffer.size() == buffer.capacity()) flush();
+}
+
+void RecordingWriter::flush() {
+    if (file == nullptr || buffer.empty()) return;
+    std::fwrite(buffer.data(), sizeof(PoseRecord), buffer.size(), file);
+    std::fflush(file);
+    written += buffer.size();
+    buffer.clear();
+}
+
+void RecordingWriter::close() {
+    if (file == nullptr) return;
+    flush();
+    std::fclose(file);
+    file = nullptr;
+}
+
+size_t RecordingWriter::count() const {
+    return written + buffer.size();
+}
+
+RecordingReader::RecordingReader() {
+    header = RecordingHeader();
+    data = nullptr;
+    length = 0;
+    records = 0;
+}
+
+RecordingReader::~RecordingReader() {
+#ifndef _WIN32
+    if (data != nullptr && fallback.empty()) munmap(const_cast<unsigned char *>(data), length);
+#endif
+}
+
+// Maps the file and checks its header; a trailing partial record (from a recording cut off mid-write) is ignored
+bool RecordingReader::open(const std::string &filename) {
+#ifndef _WIN32
+    int descriptor = ::open(filename.c_str(), O_RDONLY);
+    if (descriptor < 0) return false;
+    struct stat status;
+    if (fstat(descriptor, &status) == 0 && status.st_size > 0) {
+        length = status.st_size;
+        void *mapped = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, descriptor, 0);
+        if (mapped != MAP_FAILED) data = static_cast<const unsigned char *>(mapped);
+    }
+    ::close(descriptor);
+#endif
+    if (data == nullptr) {
+        std::ifstream stream(filename, std::ios::binary);
+        if (!stream) return false;
+        fallback.assign(std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>());
+        data = fallback.data();
+        length = fallback.size();
+    }
+    if (length < sizeof(RecordingHeader)) return false;
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, "RNRC", 4) != 0 || header.version != RECORDING_VERSION || header.recordSize != sizeof(PoseRecord)) {
+        std::cout << filename << " isn't a version " << RECORDING_VERSION << " recording" << std::endl;
+        return false;
+    }
+    records = (length - sizeof(RecordingHeader)) / sizeof(PoseRecord);
+    return true;
+}
+
+size_t RecordingReader::size() const {
+    return records;
+}
+
+const PoseRecord &RecordingReader::operator[](size_t index) const {
+    return reinterpret_cast<const PoseRecord *>(data + sizeof(RecordingHeader))[index];
+}
+
+// Converts a recording in the old text format (a "pos: x, y, z" line then three "orientN: a, b, c" rows per pose) to
+// the binary one. The text format has no clock, but it was recorded at a fixed 1/300 s a pose, so that gives the times.
+bool convertTextRecording(const std::string &textFilename, const std::string &binaryFilename) {
+    std::ifstream text(textFilename);
+    if (!text) return false;
+    RecordingWriter writer = RecordingWriter();
+    if (!writer.open(binaryFilename, RECORDING_HAS_TIME)) return false;
+    std::string line;
+    glm::vec3 position;
+    glm::mat3 orientation;
+    int rows = -1;      // orientation rows still to come for the current pose, or -1 between poses
+    while (std::getline(text, line)) {
+        float a, b, c;
+        if (std::sscanf(line.c_str(), "pos: %f, %f, %f", &a, &b, &c) == 3) {
+            position = glm::vec3(a, b, c);
+            rows = 3;
+        } else if (rows > 0 && std::sscanf(line.c_str(), "orient%*d: %f, %f, %f", &a, &b, &c) == 3) {
+            int row = 3 - rows;
+            orientation[0][row] = a;
+            orientation[1][row] = b;
+            orientation[2][row] = c;
+            if (--rows == 0) {
+                writer.append(writer.count() / 300.0f, position, orientation, glm::vec3(0), "");
+                rows = -1;
+            }
+        }
+    }
+    std::cout << "converted " << writer.count() << " poses from " << textFilename << " to " << binaryFilename << std::endl;
+    writer.close();
+    return true;
+}
@@ -0,0 +1,83 @@
+//
+// Created by Samuel Stephens on 19/10/2026.
+//
+
+#ifndef RECORDING_H
+#define RECORDING_H
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+
+// A recorded camera path on disk is a RecordingHeader followed by fixed-size PoseRecords, so playback can map the file
+// and index it directly instead of parsing it. Everything is little-endian floats and integers.
+const uint32_t RECORDING_VERSION = 1;
+const uint32_t RECORDING_HAS_TIME = 1;     // the records' time fields are meaningful
+const uint32_t RECORDING_HAS_LIGHT = 2;    // ... and their light positions
+const uint32_t RECORDING_HAS_MODE = 4;     // ... and their modes
+
+struct RecordingHeader {
+    char magic[4];              // "RNRC"
+    uint32_t version;
+    uint32_t recordSize;        // sizeof(PoseRecord) when it was written, so a reader can refuse a mismatched layout
+    uint32_t flags;             // which optional fields the records fill in
+};
+
+struct PoseRecord {
+    float time;                 // seconds into the recording
+    float position[3];
+    float orientation[9];       // camera orientation, column-major like glm::mat3
+    float light[3];             // where the selected light was
+    char mode[16];              // the mode to render this pose in, zero padded
+
+    glm::vec3 cameraPosition() const;
+    glm::mat3 cameraOrientation() const;
+    glm::vec3 lightPosition() const;
+    std::string modeName() const;
+};
+
+// Appends pose records to a new recording file, buffering them so the disk sees a write every few hundred poses
+class RecordingWriter {
+    public:
+    RecordingWriter();
+    ~RecordingWriter();
+    bool open(const std::string &filename, uint32_t flags);
+    bool isOpen() const;
+    void append(float time, glm::vec3 position, glm::mat3 orientation, glm::vec3 light, const std::string &mode);
+    void flush();
+    void close();
+    size_t count() const;
+
+    private:
+    std::FILE *file;
+    std::vector<PoseRecord> buffer;
+    size_t written;
+};
+
+// Read-only view of a recording file, memory-mapped so even long recordings open instantly
+class RecordingReader {
+    public:
+    RecordingHeader header;
+
+    RecordingReader();
+    ~RecordingReader();
+    RecordingReader(const RecordingReader &) = delete;
+    RecordingReader &operator=(const RecordingReader &) = delete;
+    bool open(const std::string &filename);
+    size_t size() const;
+    const PoseRecord &operator[](size_t index) const;
+
+    private:
+    const unsigned char *data;
+    size_t length;
+    size_t records;
+    std::vector<unsigned char> fallback;        // the file's contents where it can't be mapped
+};
+
+bool convertTextRecording(const std::string &textFilename, const std::string &binaryFilename);
+
+
+
+#endif //RECORDING_H
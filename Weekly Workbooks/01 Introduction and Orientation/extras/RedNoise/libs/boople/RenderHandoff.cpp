@@ -0,0 +1,76 @@
+//
+// Created by Samuel Stephens on 19/10/2026.
+//
+
+#include "RenderHandoff.h"
+#include <chrono>
+
+RenderHandoff::RenderHandoff() {
+    sequence = 0;
+    ready = false;
+    stopping = false;
+}
+
+// Whether two snapshots would draw the same frame
+static bool sameState(const RenderSnapshot &a, const RenderSnapshot &b) {
+    return a.camera.position == b.camera.position && a.camera.orientation == b.camera.orientation && a.camera.focalLength == b.camera.focalLength
+            && a.camera.fieldOfView == b.camera.fieldOfView && a.camera.mode == b.camera.mode && a.camera.revision == b.camera.revision
+            && a.lights.lights.size() == b.lights.lights.size() && a.lights.revision() == b.lights.revision() && a.settings == b.settings
+            && a.progressive == b.progressive && a.dynamicResolution == b.dynamicResolution && a.reshades == b.reshades;
+}
+
+// Hands the render thread a new snapshot, unless nothing in it changed since the last one, so the render thread can
+// sleep while the input is idle instead of waking every tick to copy the same state. Copy assignment reuses the
+// snapshot's storage, so publishing the same sized state doesn't allocate.
+void RenderHandoff::publish(const RenderSnapshot &snapshot) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (sequence > 0 && sameState(latest, snapshot)) return;
+    latest = snapshot;
+    sequence++;
+    changed.notify_all();
+}
+
+// Copies the latest snapshot if it is newer than seen; returns whether it was
+bool RenderHandoff::take(RenderSnapshot &snapshot, unsigned long &seen) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (sequence == seen) return false;
+    snapshot = latest;
+    seen = sequence;
+    return true;
+}
+
+// Sleeps the render thread until there is a snapshot newer than seen, or for at most the given time
+void RenderHandoff::waitForChange(unsigned long seen, int milliseconds) {
+    std::unique_lock<std::mutex> lock(mutex);
+    changed.wait_for(lock, std::chrono::milliseconds(milliseconds), [&]() { return sequence != seen || stopping; });
+}
+
+// Marks the back buffer as holding a finished frame and blocks until the main thread has swapped it to the front,
+// so the next frame can't start drawing over it first
+void RenderHandoff::finishFrame() {
+    std::unique_lock<std::mutex> lock(mutex);
+    ready = true;
+    changed.wait(lock, [&]() { return !ready || stopping; });
+}
+
+bool RenderHandoff::frameReady() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return ready;
+}
+
+void RenderHandoff::frameShown() {
+    std::lock_guard<std::mutex> lock(mutex);
+    ready = false;
+    changed.notify_all();
+}
+
+void RenderHandoff::stop() {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+    changed.notify_all();
+}
+
+bool RenderHandoff::stopped() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return stopping;
+}
@@ -0,0 +1,50 @@
+//
+// Created by Samuel Stephens on 19/10/2026.
+//
+
+#ifndef RENDERHANDOFF_H
+#define RENDERHANDOFF_H
+#include <condition_variable>
+#include <mutex>
+#include "Camera.h"
+#include "LightSet.h"
+#include "RenderSettings.h"
+
+// What the render thread draws a frame from: copies of the input thread's state, so input can keep changing the originals
+struct RenderSnapshot {
+    Camera camera;
+    LightSet lights;
+    RenderSettings settings;
+    bool progressive = false;           // progressive refinement is on
+    bool dynamicResolution = false;
+    unsigned long reshades = 0;         // bumped for changes no revision covers (the quality settings)
+};
+
+// Passes snapshots from the input (main) thread to the render thread, and finished frames back. Only the main thread
+// may call SDL, so the render thread draws into the window's back buffer and waits while main swaps it to the front.
+class RenderHandoff {
+    public:
+    std::mutex window;                  // held by whichever thread is drawing into the window's back buffer
+
+    RenderHandoff();
+    void publish(const RenderSnapshot &snapshot);
+    bool take(RenderSnapshot &snapshot, unsigned long &seen);
+    void waitForChange(unsigned long seen, int milliseconds);
+    void finishFrame();
+    bool frameReady();
+    void frameShown();
+    void stop();
+    bool stopped();
+
+    private:
+    std::mutex mutex;
+    std::condition_variable changed;
+    RenderSnapshot latest;
+    unsigned long sequence;             // bumped by every publish that changed something
+    bool ready;                         // a finished frame is waiting in the back buffer
+    bool stopping;
+};
+
+
+
+#endif //RENDERHANDOFF_H
@@ -0,0 +1,32 @@
+//
+// Created by Samuel Stephens on 19/10/2026.
+//
+
+#include "RenderSettings.h"
+
+RenderSettings::RenderSettings() {
+    maxDepth = 4;
+    rouletteDepth = 2;
+    refractiveIndex = 1.5;
+    lightSamples = 2;
+    maxPathSamples = 1024;
+    antialias = false;
+    antialiasSamples = 4;
+    depthThreshold = 0.05;
+    normalThreshold = 0.9;
+    colourThreshold = 24;
+    // the proximity-only mode is the quick preview, the others can afford smoother penumbrae
+    shadowSamples = {{"RAYTRACE_P", 4}, {"RAYTRACE_D", 16}, {"RAYTRACE_TM", 16}, {"RAYTRACE_R", 16}, {"RAYTRACE_G", 16}, {"HYBRID", 16}};
+}
+
+int RenderSettings::shadowSamplesFor(const std::string &mode) const {
+    auto found = shadowSamples.find(mode);
+    return found == shadowSamples.end() ? 1 : found->second;
+}
+
+bool RenderSettings::operator==(const RenderSettings &settings) const {
+    return maxDepth == settings.maxDepth && rouletteDepth == settings.rouletteDepth && refractiveIndex == settings.refractiveIndex
+            && shadowSamples == settings.shadowSamples && lightSamples == settings.lightSamples && maxPathSamples == settings.maxPathSamples
+            && antialias == settings.antialias && antialiasSamples == settings.antialiasSamples && depthThreshold == settings.depthThreshold
+            && normalThreshold == settings.normalThreshold && colourThreshold == settings.colourThreshold;
+}
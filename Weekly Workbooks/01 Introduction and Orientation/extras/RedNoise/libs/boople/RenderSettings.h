@@ -0,0 +1,32 @@
+//
+// Created by Samuel Stephens on 19/10/2026.
+//
+
+#ifndef RENDERSETTINGS_H
+#define RENDERSETTINGS_H
+#include <map>
+#include <string>
+
+// Quality knobs shared by the raytraced modes
+class RenderSettings {
+    public:
+    int maxDepth;           // most mirror/glass bounces followed from a primary hit
+    int rouletteDepth;      // bounces after which paths may be terminated by Russian roulette
+    float refractiveIndex;  // for the glass surfaces
+    std::map<std::string, int> shadowSamples;   // area light samples per pixel, by mode
+    int lightSamples;       // lights picked per pixel when there are several
+    int maxPathSamples;     // the path tracer stops accumulating after this many passes
+    bool antialias;         // supersample the pixels on edges after the one ray per pixel pass
+    int antialiasSamples;   // extra primary rays for each edge pixel (at most 4)
+    float depthThreshold;   // relative depth jump between neighbours that counts as an edge
+    float normalThreshold;  // cosine of the angle between neighbours' normals below which they count as an edge
+    int colourThreshold;    // difference in any channel (0-255) between neighbours that counts as an edge
+
+    RenderSettings();
+    int shadowSamplesFor(const std::string &mode) const;
+    bool operator==(const RenderSettings &settings) const;
+};
+
+
+
+#endif //RENDERSETTINGS_H
@@ -0,0 +1,47 @@
+//
+// Created by Samuel Stephens on 19/10/2026.
+//
+
+#include "ResolutionScaler.h"
+#include <algorithm>
+#include <cmath>
+
+ResolutionScaler::ResolutionScaler() {
+    enabled = false;
+    targetMilliseconds = 33;
+    minimumScale = 0.25;
+}
+
+ResolutionScaler::ResolutionScaler(double targetMilliseconds) {
+    this->enabled = true;
+    this->targetMilliseconds = targetMilliseconds;
+    this->minimumScale = 0.25;
+}
+
+float ResolutionScaler::scaleFor(const std::string &mode) const {
+    if (!enabled) return 1;
+    auto found = scales.find(mode);
+    return found == scales.end() ? 1 : found->second;
+}
+
+// A window dimension at the mode's current scale
+size_t ResolutionScaler::scaled(size_t size, const std::string &mode) const {
+    return std::max<size_t>(1, static_cast<size_t>(std::round(size * scaleFor(mode))));
+}
+
+// Takes the time of a full frame drawn at the mode's current scale and moves the scale toward the target. The cost goes
+// with the pixel count, so the scale moves by the square root of the time ratio. Returns true if the scale changed,
+// in which case the next frame needs drawing at the new size.
+bool ResolutionScaler::update(const std::string &mode, double milliseconds) {
+    if (!enabled || milliseconds <= 0) return false;
+    float current = scaleFor(mode);
+    float ideal = current * static_cast<float>(std::sqrt(targetMilliseconds / milliseconds));
+    // only move half way, and in steps of 1/32, so one slow frame doesn't halve the resolution
+    float next = std::round((current + ideal) / 2 * 32) / 32;
+    next = std::min(1.0f, std::max(minimumScale, next));
+    // leave small differences alone, since every change means re-allocating the buffers and retracing the view
+    if (std::abs(next - current) < 0.05f && next != 1) return false;
+    if (next == current) return false;
+    scales[mode] = next;
+    return true;
+}
@@ -0,0 +1,29 @@
+//
+// Created by Samuel Stephens on 19/10/2026.
+//
+
+#ifndef RESOLUTIONSCALER_H
+#define RESOLUTIONSCALER_H
+#include <cstddef>
+#include <map>
+#include <string>
+
+// Dynamic resolution: picks a fraction of the window size to render each mode at, from how long that mode's last
+// frames took, so slow modes drop resolution to hold the target frame time and fast ones stay at full size
+class ResolutionScaler {
+    public:
+    bool enabled;
+    double targetMilliseconds;      // frame time to aim for
+    float minimumScale;             // never render smaller than this fraction of the window
+    std::map<std::string, float> scales;    // the current fraction for each mode, along each axis
+
+    ResolutionScaler();
+    explicit ResolutionScaler(double targetMilliseconds);
+    float scaleFor(const std::string &mode) const;
+    size_t scaled(size_t size, const std::string &mode) const;
+    bool update(const std::string &mode, double milliseconds);
+};
+
+
+
+#endif //RESOLUTIONSCALER_H
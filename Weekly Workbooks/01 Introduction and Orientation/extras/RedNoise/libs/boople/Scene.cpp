@@ -0,0 +1,51 @@
+//
+// Created by Samuel Stephens on 19/10/2026.
+//
+
+#include "Scene.h"
+#include <algorithm>
+
+// Every Scene that's alive, so the ray queries, which are only handed a list of triangles, can find the BVH built over
+// it. Scenes are only made and deleted while nothing is rendering, so the list isn't locked.
+static std::vector<const Scene *> liveScenes;
+
+Scene::Scene(std::vector<ModelTriangle> box, std::vector<ModelTriangle> sphere, std::vector<std::vector<TexturePoint>> texture)
+    : box(std::move(box)), sphere(std::move(sphere)), texture(std::move(texture)),
+      boxBVH(triangleBounds(this->box)), sphereBVH(triangleBounds(this->sphere)) {
+    liveScenes.push_back(this);
+}
+
+Scene::~Scene() {
+    liveScenes.erase(std::find(liveScenes.begin(), liveScenes.end(), this));
+}
+
+// The sphere modes render the sphere, everything else renders the box
+const std::vector<ModelTriangle> &Scene::trianglesFor(const std::string &mode) const {
+    if (mode == "SPHERE_W" || mode == "SPHERE_G" || mode == "SPHERE_P") {
+        return sphere;
+    }
+    return box;
+}
+
+// The BVH a live Scene built over exactly these triangles, or nullptr if they aren't one of its lists
+const BVH *Scene::bvhFor(const std::vector<ModelTriangle> &triangles) {
+    for (const Scene *scene : liveScenes) {
+        if (&triangles == &scene->box) return &scene->boxBVH;
+        if (&triangles == &scene->sphere) return &scene->sphereBVH;
+    }
+    return nullptr;
+}
+
+// Boxes around the triangles, padded a little so the walls of the box, which are flat along an axis, still give the
+// ray a slab to enter however the intersection test rounds
+std::vector<BoundingBox> Scene::triangleBounds(const std::vector<ModelTriangle> &triangles) {
+    const glm::vec3 padding = glm::vec3(1e-4f);
+    std::vector<BoundingBox> bounds(triangles.size());
+    for (size_t index = 0; index < triangles.size(); index++) {
+        for (const auto &vertex : triangles[index].vertices) {
+            bounds[index].grow(vertex - padding);
+            bounds[index].grow(vertex + padding);
+        }
+    }
+    return bounds;
+}
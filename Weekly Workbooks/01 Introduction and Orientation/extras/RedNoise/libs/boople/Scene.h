@@ -0,0 +1,36 @@
+//
+// Created by Samuel Stephens on 19/10/2026.
+//
+
+#ifndef SCENE_H
+#define SCENE_H
+#include <string>
+#include <vector>
+#include <sdw/ModelTriangle.h>
+#include <sdw/TexturePoint.h>
+#include "BVH.h"
+
+// Everything loaded from disk that the renderer reads but never changes. Built once in main and handed
+// around by const reference, so it can't be copied by accident.
+class Scene {
+    public:
+    const std::vector<ModelTriangle> box;       // the cornell box
+    const std::vector<ModelTriangle> sphere;
+    const std::vector<std::vector<TexturePoint>> texture;
+    const BVH boxBVH;                           // built over box once it's loaded, so rays only test the triangles near them
+    const BVH sphereBVH;
+
+    explicit Scene(std::vector<ModelTriangle> box, std::vector<ModelTriangle> sphere, std::vector<std::vector<TexturePoint>> texture);
+    ~Scene();
+    Scene(const Scene &) = delete;
+    Scene &operator=(const Scene &) = delete;
+    const std::vector<ModelTriangle> &trianglesFor(const std::string &mode) const;
+    static const BVH *bvhFor(const std::vector<ModelTriangle> &triangles);
+
+    private:
+    static std::vector<BoundingBox> triangleBounds(const std::vector<ModelTriangle> &triangles);
+};
+
+
+
+#endif //SCENE_H
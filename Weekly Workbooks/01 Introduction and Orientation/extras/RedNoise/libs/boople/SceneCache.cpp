@@ -0,0 +1,136 @@
+//
+// Created by Samuel Stephens on 19/10/2026.
+//
+
+#include "SceneCache.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+const uint32_t SCENE_CACHE_VERSION = 1;
+
+struct SceneCacheHeader {
+    char magic[4];              // "RNSC"
+    uint32_t version;
+    uint32_t boxTriangles;
+    uint32_t sphereTriangles;
+    uint32_t textureWidth;
+    uint32_t textureHeight;
+};
+
+struct CachedTriangle {
+    float vertices[9];
+    float texturePoints[6];
+    int32_t colour[3];
+    float normal[3];
+    int32_t textured;
+};
+
+struct CachedTexturePoint {
+    float x;
+    float y;
+    int32_t colour[3];
+};
+
+static bool writeTriangles(std::FILE *file, const std::vector<ModelTriangle> &triangles) {
+    std::vector<CachedTriangle> records(triangles.size());
+    for (size_t index = 0; index < triangles.size(); index++) {
+        const ModelTriangle &triangle = triangles[index];
+        CachedTriangle &record = records[index];
+        for (int k = 0; k < 3; k++) {
+            for (int axis = 0; axis < 3; axis++) record.vertices[k * 3 + axis] = triangle.vertices[k][axis];
+            record.texturePoints[k * 2] = triangle.texturePoints[k].x;
+            record.texturePoints[k * 2 + 1] = triangle.texturePoints[k].y;
+            record.normal[k] = triangle.normal[k];
+        }
+        record.colour[0] = triangle.colour.red;
+        record.colour[1] = triangle.colour.green;
+        record.colour[2] = triangle.colour.blue;
+        record.textured = triangle.textured;
+    }
+    return std::fwrite(records.data(), sizeof(CachedTriangle), records.size(), file) == records.size();
+}
+
+static bool readTriangles(std::FILE *file, size_t count, std::vector<ModelTriangle> &triangles) {
+    std::vector<CachedTriangle> records(count);
+    if (std::fread(records.data(), sizeof(CachedTriangle), count, file) != count) return false;
+    triangles.resize(count);
+    for (size_t index = 0; index < count; index++) {
+        const CachedTriangle &record = records[index];
+        ModelTriangle &triangle = triangles[index];
+        for (int k = 0; k < 3; k++) {
+            triangle.vertices[k] = glm::vec3(record.vertices[k * 3], record.vertices[k * 3 + 1], record.vertices[k * 3 + 2]);
+            triangle.texturePoints[k] = TexturePoint(record.texturePoints[k * 2], record.texturePoints[k * 2 + 1]);
+        }
+        triangle.colour = Colour(record.colour[0], record.colour[1], record.colour[2]);
+        // stored rather than recomputed, so the loaded triangles are exactly the ones that were saved
+        triangle.normal = glm::vec3(record.normal[0], record.normal[1], record.normal[2]);
+        triangle.textured = record.textured != 0;
+    }
+    return true;
+}
+
+bool saveSceneCache(const Scene &scene, const std::string &filename) {
+    std::FILE *file = std::fopen(filename.c_str(), "wb");
+    if (file == nullptr) return false;
+    const uint32_t textureHeight = scene.texture.size();
+    const uint32_t textureWidth = textureHeight > 0 ? scene.texture[0].size() : 0;
+    SceneCacheHeader header = {{'R', 'N', 'S', 'C'}, SCENE_CACHE_VERSION, static_cast<uint32_t>(scene.box.size()), static_cast<uint32_t>(scene.sphere.size()), textureWidth, textureHeight};
+    bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1 && writeTriangles(file, scene.box) && writeTriangles(file, scene.sphere);
+    std::vector<CachedTexturePoint> row(textureWidth);
+    for (uint32_t y = 0; ok && y < textureHeight; y++) {
+        for (uint32_t x = 0; x < textureWidth; x++) {
+            const TexturePoint &point = scene.texture[y][x];
+            row[x] = {point.x, point.y, {point.colour.red, point.colour.green, point.colour.blue}};
+        }
+        ok = std::fwrite(row.data(), sizeof(CachedTexturePoint), row.size(), file) == row.size();
+    }
+    return std::fclose(file) == 0 && ok;
+}
+
+// Saves the cache under a new, uniquely named file in the temp directory, so runs at the same time can't overwrite each
+// other's. Returns the file's name, or an empty string if it couldn't be written; whoever asked for it removes it.
+std::string saveTemporarySceneCache(const Scene &scene) {
+#ifndef _WIN32
+    const char *directory = std::getenv("TMPDIR");
+    std::string name = std::string(directory != nullptr && directory[0] != '\0' ? directory : "/tmp") + "/scene-XXXXXX.rnsc";
+    int descriptor = mkstemps(&name[0], 5);
+    if (descriptor < 0) return "";
+    close(descriptor);
+#else
+    char buffer[L_tmpnam];
+    if (std::tmpnam(buffer) == nullptr) return "";
+    std::string name = buffer;
+#endif
+    if (saveSceneCache(scene, name)) return name;
+    std::remove(name.c_str());
+    return "";
+}
+
+// Returns a new Scene, or nullptr if the file is missing or isn't a cache this version can read
+Scene *loadSceneCache(const std::string &filename) {
+    std::FILE *file = std::fopen(filename.c_str(), "rb");
+    if (file == nullptr) return nullptr;
+    SceneCacheHeader header;
+    std::vector<ModelTriangle> box, sphere;
+    bool ok = std::fread(&header, sizeof(header), 1, file) == 1 && std::memcmp(header.magic, "RNSC", 4) == 0 && header.version == SCENE_CACHE_VERSION;
+    ok = ok && readTriangles(file, header.boxTriangles, box) && readTriangles(file, header.sphereTriangles, sphere);
+    std::vector<std::vector<TexturePoint>> texture;
+    std::vector<CachedTexturePoint> row(ok ? header.textureWidth : 0);
+    for (uint32_t y = 0; ok && y < header.textureHeight; y++) {
+        ok = std::fread(row.data(), sizeof(CachedTexturePoint), row.size(), file) == row.size();
+        std::vector<TexturePoint> points;
+        points.reserve(row.size());
+        for (const CachedTexturePoint &point : row) {
+            points.emplace_back(point.x, point.y, Colour(point.colour[0], point.colour[1], point.colour[2]));
+        }
+        texture.push_back(std::move(points));
+    }
+    std::fclose(file);
+    if (!ok) return nullptr;
+    return new Scene(std::move(box), std::move(sphere), std::move(texture));
+}
@@ -0,0 +1,18 @@
+//
+// Created by Samuel Stephens on 19/10/2026.
+//
+
+#ifndef SCENECACHE_H
+#define SCENECACHE_H
+#include <string>
+#include "Scene.h"
+
+// A Scene as it is in memory once the OBJs and the texture are parsed, written out flat so other processes can load it
+// without parsing anything: a header with the counts, then the box and sphere triangles, then the texture's points.
+bool saveSceneCache(const Scene &scene, const std::string &filename);
+std::string saveTemporarySceneCache(const Scene &scene);
+Scene *loadSceneCache(const std::string &filename);
+
+
+
+#endif //SCENECACHE_H
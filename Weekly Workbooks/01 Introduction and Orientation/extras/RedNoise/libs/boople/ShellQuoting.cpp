@@ -0,0 +1,16 @@
+//
+// Created by Samuel Stephens on 19/10/2026.
+//
+
+#include "ShellQuoting.h"
+
+// Single quotes keep everything inside them literal, so the only thing to escape is a single quote itself: close the
+// quotes, add an escaped one, and open them again
+std::string shellQuoted(const std::string &text) {
+    std::string quoted = "'";
+    for (char c : text) {
+        if (c == '\'') quoted += "'\\''";
+        else quoted += c;
+    }
+    return quoted + "'";
+}
@@ -0,0 +1,14 @@
+//
+// Created by Samuel Stephens on 19/10/2026.
+//
+
+#ifndef SHELLQUOTING_H
+#define SHELLQUOTING_H
+#include <string>
+
+// Quotes text as a single argument for the shell, for the commands handed to popen: worker processes and ffmpeg
+std::string shellQuoted(const std::string &text);
+
+
+
+#endif //SHELLQUOTING_H
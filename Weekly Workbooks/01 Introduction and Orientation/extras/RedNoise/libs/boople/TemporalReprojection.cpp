@@ -0,0 +1,108 @@
+//
+// Created by Samuel Stephens on 19/10/2026.
+//
+
+#include "TemporalReprojection.h"
+#include <algorithm>
+#include <cmath>
+
+TemporalReprojection::TemporalReprojection() {
+    enabled = false;
+    depthTolerance = 0.01;
+    maxViewAngle = 2;
+    maxAge = 8;
+    checkInterval = 64;
+    errorLimit = 4;
+    reused = 0;
+    shaded = 0;
+    checkedError = 0;
+    valid = false;
+    toRaySpace = glm::mat3(1);
+    lightRevision = 0;
+    width = 0;
+    height = 0;
+}
+
+// Shading only carries over between frames of the same mode, lit the same way (begin() checks the size)
+bool TemporalReprojection::matches(const Camera &camera, const LightSet &lights) const {
+    return valid && camera.mode == this->camera.mode && lights.revision() == lightRevision;
+}
+
+// Looks for sample's surface in the previous frame; if it can be reused, sets colour to what it was shaded there.
+// Only call after matches() said yes.
+bool TemporalReprojection::reuse(size_t x, size_t y, const GBufferSample &sample, const Camera &camera, uint32_t &colour) {
+    const size_t index = y * width + x;
+    nextAges[index] = 0;
+    if (!sample.hit) return false;
+    // inverse of the primary ray mapping: pixel x was traced with i = width/2 - (x + 0.5), likewise for y
+    const glm::vec3 ray = toRaySpace * (sample.position - this->camera.position);
+    if (ray.z <= 0) return false;
+    const long px = std::lround(width / 2.0f - 0.5f - ray.x / ray.z);
+    const long py = std::lround(height / 2.0f - 0.5f - ray.y / ray.z);
+    if (px < 0 || py < 0 || px >= static_cast<long>(width) || py >= static_cast<long>(height)) return false;
+    const size_t previous = py * width + px;
+    const GBufferSample &before = samples[previous];
+    if (!before.valid || !before.hit || before.triangleIndex != sample.triangleIndex || ages[previous] >= maxAge) return false;
+    const glm::vec3 fromBefore = sample.position - this->camera.position;
+    const float depth = glm::length(fromBefore);
+    if (std::abs(before.depth - depth) > depthTolerance * depth) return false;
+    const glm::vec3 fromNow = sample.position - camera.position;
+    const float cosine = glm::dot(fromBefore, fromNow) / (depth * glm::length(fromNow));
+    if (cosine < std::cos(glm::radians(maxViewAngle))) return false;
+    colour = colours[previous];
+    nextAges[index] = ages[previous] + 1;
+    return true;
+}
+
+// Records the colour pixel (x, y) ends up with in the frame being drawn
+void TemporalReprojection::keep(size_t x, size_t y, uint32_t colour) {
+    nextColours[y * width + x] = colour;
+}
+
+// For a reused pixel that ended up shaded after all
+void TemporalReprojection::markShaded(size_t x, size_t y) {
+    nextAges[y * width + x] = 0;
+}
+
+bool TemporalReprojection::wasReused(size_t x, size_t y) const {
+    return nextAges[y * width + x] > 0;
+}
+
+// Sizes the per-pixel bookkeeping for a frame about to be drawn; a frame of a different size can't reuse anything
+void TemporalReprojection::begin(size_t width, size_t height) {
+    if (width != this->width || height != this->height) {
+        valid = false;
+        this->width = width;
+        this->height = height;
+        ages.assign(width * height, 0);
+        colours.assign(width * height, 0);
+    }
+    nextAges.assign(width * height, 0);
+    nextColours.resize(width * height);
+}
+
+// Keeps the frame just drawn, traced along rayBasis (see primaryRayBasis), as the one the next frame reprojects from
+void TemporalReprojection::store(const Camera &camera, const glm::mat3 &rayBasis, const LightSet &lights, const GBuffer &gbuffer) {
+    this->camera = camera;
+    toRaySpace = glm::inverse(rayBasis);
+    lightRevision = lights.revision();
+    samples = gbuffer.samples;
+    std::swap(colours, nextColours);
+    std::swap(ages, nextAges);
+    // after a frame shaded from scratch every pixel would come due for reshading on the same later frame, so their
+    // ages are spread out to share the reshading between the next maxAge frames
+    if (std::all_of(ages.begin(), ages.end(), [](uint8_t age) { return age == 0; })) {
+        for (size_t index = 0; index < ages.size(); index++) {
+            ages[index] = (index % width + 3 * (index / width)) % maxAge;
+        }
+    }
+    valid = true;
+}
+
+void TemporalReprojection::reset() {
+    valid = false;
+}
+
+float TemporalReprojection::reuseRate() const {
+    return reused + shaded > 0 ? static_cast<float>(reused) / (reused + shaded) : 0;
+}
@@ -0,0 +1,59 @@
+//
+// Created by Samuel Stephens on 19/10/2026.
+//
+
+#ifndef TEMPORALREPROJECTION_H
+#define TEMPORALREPROJECTION_H
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include "Camera.h"
+#include "GBuffer.h"
+#include "LightSet.h"
+
+// Carries shading over from the previous frame of a camera path. A pixel of the new frame reuses the colour of the
+// previous frame's pixel its surface point projects back onto, as long as that pixel saw the same triangle at the same
+// depth, the surface is seen from nearly the same direction (so specular highlights haven't moved) and its colour
+// hasn't already been carried forward for too many frames. Everything else is shaded afresh.
+class TemporalReprojection {
+    public:
+    bool enabled;
+    float depthTolerance;       // relative difference in depth still treated as the same surface
+    float maxViewAngle;         // degrees the direction a point is seen from may swing before it is reshaded
+    int maxAge;                 // frames a colour can be carried forward before it is reshaded
+    int checkInterval;          // one in this many reused pixels is shaded anyway to measure the reuse error
+    float errorLimit;           // mean error (in 0-255 levels) in those checks above which the frame is shaded afresh
+    int reused;                 // pixels of the last frame that took their colour from the one before
+    int shaded;                 // ... and the ones with a surface in view that were shaded
+    float checkedError;         // mean error of the last frame's checked pixels
+
+    TemporalReprojection();
+    void begin(size_t width, size_t height);
+    bool matches(const Camera &camera, const LightSet &lights) const;
+    bool reuse(size_t x, size_t y, const GBufferSample &sample, const Camera &camera, uint32_t &colour);
+    void keep(size_t x, size_t y, uint32_t colour);
+    void markShaded(size_t x, size_t y);
+    bool wasReused(size_t x, size_t y) const;
+    void store(const Camera &camera, const glm::mat3 &rayBasis, const LightSet &lights, const GBuffer &gbuffer);
+    void reset();
+    float reuseRate() const;
+
+    private:
+    bool valid;
+    Camera camera;
+    glm::mat3 toRaySpace;       // maps a point relative to the previous camera onto its pixel grid
+    unsigned long lightRevision;
+    size_t width;
+    size_t height;
+    std::vector<GBufferSample> samples;
+    std::vector<uint32_t> colours;
+    std::vector<uint32_t> nextColours;     // the frame being drawn
+    std::vector<uint8_t> ages;
+    std::vector<uint8_t> nextAges;
+};
+
+
+
+#endif //TEMPORALREPROJECTION_H
@@ -0,0 +1,136 @@
+//
+// Created by Samuel Stephens on 19/10/2026.
+//
+
+#include "TileCoordinator.h"
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <thread>
+#include "FrameCoordinator.h"
+#ifndef _WIN32
+#include <csignal>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+TileCoordinator::TileCoordinator(std::string command, size_t width, size_t height, int workers, int tileSize) {
+    this->command = std::move(command);
+    this->width = width;
+    this->height = height;
+    this->workers = workers;
+    this->tileSize = tileSize;
+}
+
+bool TileCoordinator::run() {
+    pixels.assign(width * height, 0);
+    tilesByWorker.assign(workers, 0);
+    queue.clear();
+    busy = 0;
+    int index = 0;
+    for (int y = 0; y < static_cast<int>(height); y += tileSize) {
+        for (int x = 0; x < static_cast<int>(width); x += tileSize) {
+            queue.push_back({index++, x, y, std::min(tileSize, static_cast<int>(width) - x), std::min(tileSize, static_cast<int>(height) - y)});
+        }
+    }
+#ifndef _WIN32
+    // a worker that dies should make writing its next request fail, not kill the coordinator
+    std::signal(SIGPIPE, SIG_IGN);
+#endif
+    // every process is started before any thread, so no worker inherits another one's pipes by forking mid-way
+    std::vector<WorkerProcess> processes;
+    for (int worker = 0; worker < workers; worker++) {
+        WorkerProcess process = {worker, 0, nullptr, nullptr};
+        if (start(process)) processes.push_back(process);
+    }
+    std::vector<std::thread> threads;
+    for (const WorkerProcess &process : processes) {
+        threads.emplace_back(&TileCoordinator::work, this, process);
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    return queue.empty();
+}
+
+// Forks a worker running command with pipes on its stdin and stdout
+bool TileCoordinator::start(WorkerProcess &process) {
+#ifdef _WIN32
+    std::cerr << "tile workers need a POSIX system" << std::endl;
+    return false;
+#else
+    int requests[2], answers[2];
+    if (pipe(requests) != 0) return false;
+    if (pipe(answers) != 0) {
+        close(requests[0]);
+        close(requests[1]);
+        return false;
+    }
+    // the coordinator's ends must not leak into later workers, or closing a worker's stdin would never reach it
+    fcntl(requests[1], F_SETFD, FD_CLOEXEC);
+    fcntl(answers[0], F_SETFD, FD_CLOEXEC);
+    const pid_t child = fork();
+    if (child == 0) {
+        dup2(requests[0], STDIN_FILENO);
+        dup2(answers[1], STDOUT_FILENO);
+        close(requests[0]);
+        close(answers[1]);
+        execl("/bin/sh", "sh", "-c", command.c_str(), static_cast<char *>(nullptr));
+        _exit(127);
+    }
+    close(requests[0]);
+    close(answers[1]);
+    if (child < 0) {
+        close(requests[1]);
+        close(answers[0]);
+        return false;
+    }
+    process.pid = child;
+    process.requests = fdopen(requests[1], "w");
+    process.answers = fdopen(answers[0], "rb");
+    return true;
+#endif
+}
+
+// Feeds one worker tiles until there are none left or it stops answering, then lets it exit
+void TileCoordinator::work(WorkerProcess process) {
+#ifndef _WIN32
+    FrameStreamHeader header;
+    std::vector<uint32_t> tilePixels;
+    while (true) {
+        Tile tile;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            // a tile out with another worker comes back if that worker dies, so this one waits until they're all in
+            changed.wait(lock, [&] { return !queue.empty() || busy == 0; });
+            if (queue.empty()) break;
+            tile = queue.front();
+            queue.pop_front();
+            busy++;
+        }
+        const bool answered = std::fprintf(process.requests, "%d %d %d %d %d\n", tile.index, tile.x, tile.y, tile.width, tile.height) > 0 && std::fflush(process.requests) == 0
+                && readStreamFrame(process.answers, header, tilePixels) && static_cast<int>(header.frame) == tile.index
+                && static_cast<int>(header.width) == tile.width && static_cast<int>(header.height) == tile.height;
+        if (answered) {
+            // tiles never overlap, so they can be composited without holding the lock
+            for (int row = 0; row < tile.height; row++) {
+                std::copy_n(tilePixels.begin() + row * tile.width, tile.width, pixels.begin() + (tile.y + row) * width + tile.x);
+            }
+            tilesByWorker[process.id]++;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        busy--;
+        if (!answered) {
+            std::cerr << "tile worker " << process.id << " stopped answering, handing tile " << tile.index << " to the others" << std::endl;
+            queue.push_front(tile);
+        }
+        changed.notify_all();
+        if (!answered) break;
+    }
+    // closing its stdin is the worker's cue to exit
+    std::fclose(process.requests);
+    std::fclose(process.answers);
+    waitpid(static_cast<pid_t>(process.pid), nullptr, 0);
+#endif
+}
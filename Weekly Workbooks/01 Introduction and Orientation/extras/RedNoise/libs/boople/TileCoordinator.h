@@ -0,0 +1,62 @@
+//
+// Created by Samuel Stephens on 19/10/2026.
+//
+
+#ifndef TILECOORDINATOR_H
+#define TILECOORDINATOR_H
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// A rectangle of the frame, in pixels
+struct Tile {
+    int index;
+    int x;
+    int y;
+    int width;
+    int height;
+};
+
+// Renders one frame by splitting it into tiles and handing them to long-lived worker processes on this machine, one
+// tile at a time per worker, so the tiles that are expensive to trace don't hold up the rest. A worker is started with
+// the shell command it's given and then reads requests of the form "INDEX X Y WIDTH HEIGHT" from stdin, one per line,
+// and answers each one on stdout as a frame stream frame (see FrameCoordinator.h) numbered with the tile's index. The
+// tiles are composited into pixels as they come back; a worker that dies has its tile handed to the others.
+class TileCoordinator {
+    public:
+    int workers;
+    int tileSize;
+    size_t width;
+    size_t height;
+    std::vector<uint32_t> pixels;       // the composited frame
+    std::vector<int> tilesByWorker;     // how many tiles each worker rendered
+
+    TileCoordinator(std::string command, size_t width, size_t height, int workers, int tileSize);
+    bool run();
+
+    private:
+    struct WorkerProcess {
+        int id;
+        long pid;
+        std::FILE *requests;
+        std::FILE *answers;
+    };
+
+    std::string command;
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<Tile> queue;
+    int busy;                           // tiles out with workers right now
+
+    bool start(WorkerProcess &process);
+    void work(WorkerProcess process);
+};
+
+
+
+#endif //TILECOORDINATOR_H
@@ -0,0 +1,126 @@
+//
+// Created by Samuel Stephens on 19/10/2026.
+//
+
+#include "VideoWriter.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include "ShellQuoting.h"
+#ifdef _WIN32
+#define popen _popen
+#define pclose _pclose
+#else
+#include <csignal>
+#endif
+
+VideoWriter::VideoWriter() {
+    output = nullptr;
+    piped = false;
+    width = 0;
+    height = 0;
+    written = 0;
+}
+
+VideoWriter::~VideoWriter() {
+    close();
+}
+
+static bool endsWith(const std::string &text, const std::string &suffix) {
+    return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// Starts a new video of width x height frames, replacing anything already at filename
+bool VideoWriter::open(const std::string &filename, size_t width, size_t height, float framesPerSecond) {
+    close();
+    this->width = width;
+    this->height = height;
+    written = 0;
+    pixels.resize(width * height);
+    // frame rates go in as a fraction, thousandths are plenty
+    const long rate = std::lround(framesPerSecond * 1000);
+    piped = !endsWith(filename, ".y4m");
+    if (piped) {
+        // ARGB words in memory are B, G, R, A bytes on the little-endian machines this runs on
+        const std::string command = "ffmpeg -loglevel error -y -f rawvideo -pix_fmt bgra -video_size " + std::to_string(width) + "x" + std::to_string(height)
+                + " -framerate " + std::to_string(rate) + "/1000 -i - -pix_fmt yuv420p " + shellQuoted(filename);
+#ifndef _WIN32
+        // if ffmpeg is missing or gives up, writing to the pipe should fail rather than kill the renderer
+        std::signal(SIGPIPE, SIG_IGN);
+#endif
+        output = popen(command.c_str(), "w");
+    } else {
+        output = std::fopen(filename.c_str(), "wb");
+        if (output != nullptr) {
+            std::fprintf(output, "YUV4MPEG2 W%zu H%zu F%ld:1000 Ip A1:1 C420jpeg XCOLORRANGE=FULL\n", width, height, rate);
+        }
+    }
+    if (output == nullptr) {
+        std::cout << "could not open " << filename << " for video" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool VideoWriter::isOpen() const {
+    return output != nullptr;
+}
+
+// Appends the window's current frame, which has to be the size the video was opened with
+bool VideoWriter::writeFrame(DrawingWindow &window) {
+    if (output == nullptr || window.width != width || window.height != height) return false;
+    for (size_t y = 0; y < height; y++) {
+        for (size_t x = 0; x < width; x++) {
+            pixels[y * width + x] = window.getPixelColour(x, y);
+        }
+    }
+    if (piped) {
+        written++;
+        return std::fwrite(pixels.data(), sizeof(uint32_t), pixels.size(), output) == pixels.size();
+    }
+    // BT.601 full range, chroma averaged over each 2x2 block (clamped at odd edges)
+    const size_t chromaWidth = (width + 1) / 2, chromaHeight = (height + 1) / 2;
+    planes.resize(width * height + 2 * chromaWidth * chromaHeight);
+    uint8_t *luma = planes.data(), *blue = luma + width * height, *red = blue + chromaWidth * chromaHeight;
+    auto channels = [](uint32_t colour, float &r, float &g, float &b) {
+        r = (colour >> 16) & 0xFF;
+        g = (colour >> 8) & 0xFF;
+        b = colour & 0xFF;
+    };
+    auto clamp = [](float value) { return static_cast<uint8_t>(std::fmin(std::fmax(std::round(value), 0.0f), 255.0f)); };
+    for (size_t index = 0; index < width * height; index++) {
+        float r, g, b;
+        channels(pixels[index], r, g, b);
+        luma[index] = clamp(0.299f * r + 0.587f * g + 0.114f * b);
+    }
+    for (size_t cy = 0; cy < chromaHeight; cy++) {
+        for (size_t cx = 0; cx < chromaWidth; cx++) {
+            float r = 0, g = 0, b = 0;
+            for (size_t k = 0; k < 4; k++) {
+                const size_t x = std::min(cx * 2 + k % 2, width - 1), y = std::min(cy * 2 + k / 2, height - 1);
+                float pr, pg, pb;
+                channels(pixels[y * width + x], pr, pg, pb);
+                r += pr / 4;
+                g += pg / 4;
+                b += pb / 4;
+            }
+            blue[cy * chromaWidth + cx] = clamp(128 - 0.168736f * r - 0.331264f * g + 0.5f * b);
+            red[cy * chromaWidth + cx] = clamp(128 + 0.5f * r - 0.418688f * g - 0.081312f * b);
+        }
+    }
+    std::fputs("FRAME\n", output);
+    written++;
+    return std::fwrite(planes.data(), 1, planes.size(), output) == planes.size();
+}
+
+// Finishes the video; for ffmpeg this waits for it to encode the last frames. False if anything went wrong.
+bool VideoWriter::close() {
+    if (output == nullptr) return true;
+    const bool ok = piped ? pclose(output) == 0 : std::fclose(output) == 0;
+    output = nullptr;
+    return ok;
+}
+
+int VideoWriter::frames() const {
+    return written;
+}
@@ -0,0 +1,41 @@
+//
+// Created by Samuel Stephens on 19/10/2026.
+//
+
+#ifndef VIDEOWRITER_H
+#define VIDEOWRITER_H
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <sdw/DrawingWindow.h>
+
+// Streams rendered frames straight into a video as they finish, instead of leaving an image per frame behind.
+// A .y4m filename is written directly as YUV4MPEG2 (4:2:0, full range); anything else is handed to ffmpeg through a
+// pipe as raw frames, and ffmpeg picks the container and codec from the extension.
+class VideoWriter {
+    public:
+    VideoWriter();
+    ~VideoWriter();
+    VideoWriter(const VideoWriter &) = delete;
+    VideoWriter &operator=(const VideoWriter &) = delete;
+    bool open(const std::string &filename, size_t width, size_t height, float framesPerSecond);
+    bool isOpen() const;
+    bool writeFrame(DrawingWindow &window);
+    bool close();
+    int frames() const;
+
+    private:
+    std::FILE *output;
+    bool piped;                 // output is ffmpeg's stdin rather than a file
+    size_t width;
+    size_t height;
+    int written;
+    std::vector<uint32_t> pixels;
+    std::vector<uint8_t> planes;    // Y, then Cb and Cr at half resolution each way
+};
+
+
+
+#endif //VIDEOWRITER_H
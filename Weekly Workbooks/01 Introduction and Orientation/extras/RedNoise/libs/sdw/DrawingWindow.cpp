@@ -1,10 +1,11 @@
+#include <algorithm>
 #include <array>
 #include "DrawingWindow.h"
 // On some platforms you may need to include <cstring> (if you compiler can't find memset !)
 
 DrawingWindow::DrawingWindow() {}
 
-DrawingWindow::DrawingWindow(int w, int h, bool fullscreen) : width(w), height(h), pixelBuffer(w * h) {
+DrawingWindow::DrawingWindow(int w, int h, bool fullscreen) : width(w), height(h), pixelBuffer(w * h), frontBuffer(w * h) {
 	if (SDL_Init(SDL_INIT_VIDEO | SDL_INIT_TIMER) != 0) printMessageAndQuit("Could not initialise SDL: ", SDL_GetError());
 	uint32_t flags = SDL_WINDOW_OPENGL;
 	if (fullscreen) flags |= SDL_WINDOW_FULLSCREEN_DESKTOP;
@@ -20,12 +21,40 @@ DrawingWindow::DrawingWindow(int w, int h, bool fullscreen) : width(w), height(h
 	SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "linear");
 	SDL_RenderSetLogicalSize(renderer, width, height);
 	int PIXELFORMAT = SDL_PIXELFORMAT_ARGB8888;
-	texture = SDL_CreateTexture(renderer, PIXELFORMAT, SDL_TEXTUREACCESS_STATIC, width, height);
+	texture = SDL_CreateTexture(renderer, PIXELFORMAT, SDL_TEXTUREACCESS_STREAMING, width, height);
 	if (!texture) printMessageAndQuit("Could not allocate texture: ", SDL_GetError());
 }
 
-void DrawingWindow::renderFrame() {
-	SDL_UpdateTexture(texture, nullptr, pixelBuffer.data(), width * sizeof(uint32_t));
+DrawingWindow::DrawingWindow(int w, int h) : width(w), height(h), pixelBuffer(w * h) {}
+
+// Readies the back buffer to be drawn into. After a swap it holds the frame before last, so drawing that only paints
+// over part of the last frame (a progressive pass, the overlays) asks for keepLastFrame to have it copied forward
+// first; whole frames skip the copy.
+void DrawingWindow::beginBackBuffer(bool keepLastFrame) {
+	if (backIsStale && keepLastFrame) pixelBuffer = frontBuffer;
+	backIsStale = false;
+}
+
+// Makes the finished back buffer the front buffer by swapping the two buffers' storage, so nothing is copied and the
+// renderer can start on the next frame while presentFrame uploads this one. A back buffer nothing was drawn into since
+// the last swap is older than the front, so it isn't swapped in.
+void DrawingWindow::swapBuffers() {
+	if (!texture || backIsStale) return;
+	pixelBuffer.swap(frontBuffer);
+	backIsStale = true;
+}
+
+// Locks the streaming texture, writes the front buffer straight into its pixels and shows it; the back buffer can be
+// drawn into meanwhile. The locked rows can be padded out to pitch bytes, so they're written one at a time.
+void DrawingWindow::presentFrame() {
+	if (!texture) return;
+	void *pixels;
+	int pitch;
+	if (SDL_LockTexture(texture, nullptr, &pixels, &pitch) != 0) return;
+	for (size_t y = 0; y < height; y++) {
+		std::copy_n(frontBuffer.data() + y * width, width, reinterpret_cast<uint32_t *>(static_cast<uint8_t *>(pixels) + y * pitch));
+	}
+	SDL_UnlockTexture(texture);
 	SDL_RenderClear(renderer);
 	SDL_RenderCopy(renderer, texture, nullptr, nullptr);
 	SDL_RenderPresent(renderer);
@@ -64,10 +93,8 @@ bool DrawingWindow::pollForInputEvents(SDL_Event &event) {
 			SDL_Quit();
 			printMessageAndQuit("Exiting", nullptr);
 		}
-		SDL_Event dummy;
-		// Clear the event queue by getting all available events
-		// This seems like bad practice (because it will skip some events) however preventing backlog is paramount !
-		while (SDL_PollEvent(&dummy));
+		// Rendering happens on its own thread now, so the queue no longer backs up behind slow frames and every event
+		// is handed back (call this until it returns false)
 		return true;
 	}
 	return false;
@@ -12,15 +12,23 @@ public:
 	size_t height;
 
 private:
-	SDL_Window *window;
-	SDL_Renderer *renderer;
-	SDL_Texture *texture;
+	SDL_Window *window = nullptr;
+	SDL_Renderer *renderer = nullptr;
+	// Double buffered: frames are drawn into pixelBuffer (the back buffer) while frontBuffer holds the last finished
+	// frame, which presentFrame uploads to the streaming texture. Swapping only trades the two vectors' storage.
+	SDL_Texture *texture = nullptr;
 	std::vector<uint32_t> pixelBuffer;
+	std::vector<uint32_t> frontBuffer;
+	bool backIsStale = false;	// swapped out and not drawn into since, so it's a frame behind the front buffer
 
 public:
 	DrawingWindow();
 	DrawingWindow(int w, int h, bool fullscreen);
-	void renderFrame();
+	// Offscreen window: a pixel buffer with no SDL window behind it (for headless rendering)
+	DrawingWindow(int w, int h);
+	void beginBackBuffer(bool keepLastFrame);
+	void swapBuffers();
+	void presentFrame();
 	void savePPM(const std::string &filename) const;
 	void saveBMP(const std::string &filename) const;
 	bool pollForInputEvents(SDL_Event &event);
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <cstdio>
 #include <iostream>
 #include <ostream>
@@ -19,20 +20,53 @@
 
 
 #include <boople/Camera.h>
+#include <boople/GoldenImage.h>
+#include <chrono>
+#include <iomanip>
+#include <limits>
+#include <map>
+#include <thread>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 #include "SDL_keycode.h"
 #include "SDL_scancode.h"
+#include "boople/AccumulationBuffer.h"
+#include "boople/AllocationCounter.h"
+#include "boople/CameraPath.h"
+#include "boople/FrameArena.h"
+#include "boople/FrameCoordinator.h"
+#include "boople/FrameTracker.h"
+#include "boople/GBuffer.h"
+#include "boople/InstancedScene.h"
 #include "boople/Light.h"
+#include "boople/LightSet.h"
+#include "boople/ProgressiveRefinement.h"
+#include "boople/RenderHandoff.h"
+#include "boople/Random.h"
+#include "boople/RayStack.h"
+#include "boople/Recording.h"
+#include "boople/RenderSettings.h"
+#include "boople/ResolutionScaler.h"
+#include "boople/Scene.h"
+#include "boople/SceneCache.h"
+#include "boople/ShellQuoting.h"
+#include "boople/TemporalReprojection.h"
+#include "boople/TileCoordinator.h"
+#include "boople/VideoWriter.h"
 #include "glm/detail/func_geometric.hpp"
 #include "glm/detail/type_mat.hpp"
 #include "sdw/TexturePoint.h"
 
-#define WIDTH 500
-#define HEIGHT 400
+// the window size when none is given on the command line; everything else takes its size from the frame it draws into
+#define DEFAULT_WIDTH 500
+#define DEFAULT_HEIGHT 400
 
+// The interpolation results are scratch for drawing one line or triangle, so they live in the frame arena
 template <typename T>
-std::vector<T> interp(T from, T to, int const numberOfValues) {
-	std::vector<T> outList;
+FrameVector<T> interp(T from, T to, int const numberOfValues) {
+	FrameVector<T> outList;
 	const T incr = (to-from) / static_cast<float>(numberOfValues-1);
 	outList.reserve(numberOfValues);
 	for (int i=0; i<numberOfValues; i++) {
@@ -41,8 +75,8 @@ std::vector<T> interp(T from, T to, int const numberOfValues) {
 	return outList;
 }
 
-std::vector<glm::vec2> interpv2(const glm::vec2 from, const glm::vec2 to, int const numberOfValues) {
-	std::vector<glm::vec2> outList;
+FrameVector<glm::vec2> interpv2(const glm::vec2 from, const glm::vec2 to, int const numberOfValues) {
+	FrameVector<glm::vec2> outList;
 	const glm::vec2 incr = (to-from) / static_cast<float>(numberOfValues-1);
 	outList.reserve(numberOfValues);
 	for (int i=0; i<numberOfValues; i++) {
@@ -54,8 +88,8 @@ std::vector<glm::vec2> interpv2(const glm::vec2 from, const glm::vec2 to, int co
 	return outList;
 }
 
-std::vector<glm::vec3> interpv3(const glm::vec3 from, const glm::vec3 to, int const numberOfValues) {
-	std::vector<glm::vec3> outList;
+FrameVector<glm::vec3> interpv3(const glm::vec3 from, const glm::vec3 to, int const numberOfValues) {
+	FrameVector<glm::vec3> outList;
 	const glm::vec3 incr = (to-from) / static_cast<float>(numberOfValues-1);
 	outList.reserve(numberOfValues);
 	for (int i=0; i<numberOfValues; i++) {
@@ -83,7 +117,7 @@ void drawOccludedLine(const int x1, const int y1, const float z1, const int x2,
 	glm::vec3 end = glm::vec3(x2, y2, z2);
 	auto points = interpv3(start, end, std::abs(start.x - end.x) + std::abs(start.y-end.y)+1);
 	for (auto point: points) {
-		if(point.x >=0 && point.y >= 0 && point.x < WIDTH && point.y < HEIGHT) {
+		if(point.x >=0 && point.y >= 0 && point.x < window.width && point.y < window.height) {
 			if((*depthBuffer)[point.y][point.x] < point.z ) {
 				(*depthBuffer)[point.y][point.x] = point.z;
 				window.setPixelColour(static_cast<int>(point.x), static_cast<int>(point.y),colour.asARGB());
@@ -95,11 +129,11 @@ void drawOccludedLine(const int x1, const int y1, const float z1, const int x2,
 // Draws a RGB gradient to the window
 void drawRainbow(DrawingWindow &window) {
 	window.clearPixels();
-	std::vector<glm::vec3> left = interp(glm::vec3(255,0,0), glm::vec3(255,255,0), window.height);
-	std::vector<glm::vec3> right = interp(glm::vec3(0,0,255), glm::vec3(0,255,0), window.height);
+	FrameVector<glm::vec3> left = interp(glm::vec3(255,0,0), glm::vec3(255,255,0), window.height);
+	FrameVector<glm::vec3> right = interp(glm::vec3(0,0,255), glm::vec3(0,255,0), window.height);
 	for (size_t y = 0; y < window.height; y++) {
-		std::vector<uint32_t> colours;
-		std::vector<glm::vec3> thingy = interp(left[y], right[y], window.width);
+		FrameVector<uint32_t> colours;
+		FrameVector<glm::vec3> thingy = interp(left[y], right[y], window.width);
 		for (glm::vec3 elem : thingy) {
 			colours.push_back((255<<24) + (static_cast<int>(elem.x)<<16) + (static_cast<int>(elem.y)<<8) + static_cast<int>(elem.z));
 		}
@@ -110,11 +144,11 @@ void drawRainbow(DrawingWindow &window) {
 }
 
 // Returns a random CanvasTriangle
-CanvasTriangle randomTriangle() {
+CanvasTriangle randomTriangle(const DrawingWindow &window) {
 	auto triangle = CanvasTriangle(
-	CanvasPoint(rand()%WIDTH, rand()%HEIGHT, (rand()%100)-50),
-	CanvasPoint(rand()%WIDTH, rand()%HEIGHT, (rand()%100)-50),
-	CanvasPoint(rand()%WIDTH, rand()%HEIGHT, (rand()%100)-50)
+	CanvasPoint(rand()%window.width, rand()%window.height, (rand()%100)-50),
+	CanvasPoint(rand()%window.width, rand()%window.height, (rand()%100)-50),
+	CanvasPoint(rand()%window.width, rand()%window.height, (rand()%100)-50)
 	);
 	// std::cout << triangle << std::endl;
 	return triangle;
@@ -131,7 +165,7 @@ void drawStrokedTriangle(CanvasTriangle &triangle, const Colour& c, DrawingWindo
 }
 
 // Calculate barycentric coords from a vec3 and a triangle
-glm::vec3 baryFromVec3(glm::vec3 point, ModelTriangle triangle) {
+glm::vec3 baryFromVec3(glm::vec3 point, const ModelTriangle &triangle) {
 	glm::vec3 a = triangle.vertices[0];
 	glm::vec3 b = triangle.vertices[1];
 	glm::vec3 c = triangle.vertices[2];
@@ -190,8 +224,8 @@ void drawFlatTriangle(CanvasTriangle triangle, const Colour &c, const bool drawO
 		p1 = glm::vec2(static_cast<int>(triangle.v1().x), static_cast<int>(triangle.v1().y));
 		p2 = glm::vec2(static_cast<int>(triangle.v2().x), static_cast<int>(triangle.v2().y));
 	}
-	std::vector<glm::vec2> fromPoints = interpv2(shared, p1, std::abs(shared.y-p1.y)+1);
-	std::vector<glm::vec2> toPoints = interpv2(shared, p2, std::abs(shared.y-p2.y)+1);
+	FrameVector<glm::vec2> fromPoints = interpv2(shared, p1, std::abs(shared.y-p1.y)+1);
+	FrameVector<glm::vec2> toPoints = interpv2(shared, p2, std::abs(shared.y-p2.y)+1);
 	for (int i=0; i< static_cast<int>(fromPoints.size()); i++) {
 		if (static_cast<int>(fromPoints[i].x) != static_cast<int>(toPoints[i].x) || static_cast<int>(fromPoints[i].y) != static_cast<int>(toPoints[i].y)) {
 			drawLine(fromPoints[i].x,fromPoints[i].y, toPoints[i].x, toPoints[i].y ,c,window);
@@ -219,8 +253,8 @@ void drawOccludedFlatTriangle(CanvasTriangle triangle, const Colour &c, bool dra
 		p1 = glm::vec3(static_cast<int>(triangle.v1().x), static_cast<int>(triangle.v1().y), triangle.v1().depth);
 		p2 = glm::vec3(static_cast<int>(triangle.v2().x), static_cast<int>(triangle.v2().y), triangle.v2().depth);
 	}
-	std::vector<glm::vec3> fromPoints = interpv3(shared, p1, std::abs(shared.y-p1.y)+1);
-	std::vector<glm::vec3> toPoints = interpv3(shared, p2, std::abs(shared.y-p2.y)+1);
+	FrameVector<glm::vec3> fromPoints = interpv3(shared, p1, std::abs(shared.y-p1.y)+1);
+	FrameVector<glm::vec3> toPoints = interpv3(shared, p2, std::abs(shared.y-p2.y)+1);
 	for (int i=0; i< static_cast<int>(fromPoints.size()); i++) {
 		if (static_cast<int>(fromPoints[i].x) != static_cast<int>(toPoints[i].x) || static_cast<int>(fromPoints[i].y) != static_cast<int>(toPoints[i].y)) {
 			drawOccludedLine(fromPoints[i].x,fromPoints[i].y, fromPoints[i].z, toPoints[i].x, toPoints[i].y, toPoints[i].z ,c, depthBuffer, window);
@@ -354,7 +388,7 @@ void drawTexturedLine(const int x1, const int y1, const int x2, const int y2, co
 	glm::vec2 textureEnd = glm::vec2(tx2, ty2);
 	auto texturePoints = interpv2(textureStart, textureEnd, std::abs(imageStart.x - imageEnd.x) + std::abs(imageStart.y-imageEnd.y)+1);
 	auto imagePoints = interpv2(imageStart, imageEnd, std::abs(imageStart.x - imageEnd.x) + std::abs(imageStart.y-imageEnd.y)+1);
-	std::vector<Colour> textureColours;
+	FrameVector<Colour> textureColours;
 	textureColours.reserve(texturePoints.size());
 	for (auto tp : texturePoints) {
 		textureColours.push_back(texture[tp.y][tp.x].colour);
@@ -391,12 +425,11 @@ void drawFlatTexturedTriangle(CanvasTriangle imageTriangle, const std::vector<st
 		tp2 = glm::vec2(static_cast<int>(textureTriangle.v2().x), static_cast<int>(textureTriangle.v2().y));
 		ip2 = glm::vec2(static_cast<int>(imageTriangle.v2().x), static_cast<int>(imageTriangle.v2().y));
 	}
-	std::vector<glm::vec2> imageFromPoints = interpv2(iShared, ip1, std::abs(iShared.y-ip1.y)+1);
-	std::vector<glm::vec2> imageToPoints = interpv2(iShared, ip2, std::abs(iShared.y-ip2.y)+1);
-	std::vector<glm::vec2> textureFromPoints = interpv2(tShared, tp1, std::abs(iShared.y-ip2.y)+1);
-	std::vector<glm::vec2> textureToPoints = interpv2(tShared, tp2, std::abs(iShared.y-ip2.y)+1);
+	FrameVector<glm::vec2> imageFromPoints = interpv2(iShared, ip1, std::abs(iShared.y-ip1.y)+1);
+	FrameVector<glm::vec2> imageToPoints = interpv2(iShared, ip2, std::abs(iShared.y-ip2.y)+1);
+	FrameVector<glm::vec2> textureFromPoints = interpv2(tShared, tp1, std::abs(iShared.y-ip2.y)+1);
+	FrameVector<glm::vec2> textureToPoints = interpv2(tShared, tp2, std::abs(iShared.y-ip2.y)+1);
 
-	std::vector<Colour> textureColours;
 	for (int i=0; i< static_cast<int>(imageFromPoints.size()); i++) {
 		if (static_cast<int>(imageFromPoints[i].x) != static_cast<int>(imageToPoints[i].x) || static_cast<int>(imageFromPoints[i].y) != static_cast<int>(imageToPoints[i].y)) {
 			//If there is space to interpolate between the from and to:
@@ -582,16 +615,12 @@ std::vector<ModelTriangle> parseOBJ(const std::string& filename, const float sca
 }
 
 glm::vec3 calculateVertexNormal(const glm::vec3 vertex, const std::vector<ModelTriangle>& triangles) {
-	std::vector<glm::vec3> normals;
-	for (auto triangle: triangles) {
+	glm::vec3 sum = {0,0,0};
+	for (const auto &triangle: triangles) {
 		if (vertex == triangle.vertices[0] || vertex == triangle.vertices[1] || vertex == triangle.vertices[2]) {
-			normals.push_back(triangle.normal);
+			sum += triangle.normal;
 		}
 	}
-	glm::vec3 sum = {0,0,0};
-	for (auto item : normals) {
-		sum += item;
-	}
 	return normalize(sum);
 }
 
@@ -690,48 +719,53 @@ std::vector<ModelTriangle> debugParseOBJ(const std::string& filename, const Ligh
 	return outVector;
 }
 
-// Convert vertexPosition to CanvasPoint relative to the cameraPosition
-CanvasPoint projectVertexOntoCanvasPoint(Camera *camera, const glm::vec3 vertexPosition, const float scalingFactor) {
+// Convert vertexPosition to CanvasPoint relative to the cameraPosition, for a frame the size of the window
+CanvasPoint projectVertexOntoCanvasPoint(Camera *camera, const glm::vec3 vertexPosition, const DrawingWindow &window) {
 	auto tVP = vertexPosition - camera->position;
 	tVP = camera->orientation*tVP;
-	float u = static_cast<int>(camera->focalLength * -tVP.x/tVP.z * scalingFactor + WIDTH/2);
-	float v = static_cast<int>(camera->focalLength * tVP.y/tVP.z * scalingFactor + HEIGHT/2);
+	float scalingFactor = camera->pixelScale(window.height);
+	float u = static_cast<int>(camera->focalLength * -tVP.x/tVP.z * scalingFactor + window.width/2.0f);
+	float v = static_cast<int>(camera->focalLength * tVP.y/tVP.z * scalingFactor + window.height/2.0f);
 	return {u, v, -1/tVP.z};
 }
 
-// Return a pointer to a new depthBuffer object
-std::vector<std::vector<float>> *newDepthBuffer() {
+// Return a pointer to a new depthBuffer object for a width x height frame
+std::vector<std::vector<float>> *newDepthBuffer(const size_t width, const size_t height) {
 	std::vector<std::vector<float>> *depthBuffer = new std::vector<std::vector<float>>;
 	std::vector<float> smol;
-	for (int x = 0; x < WIDTH; ++x) {
+	for (size_t x = 0; x < width; ++x) {
 		smol.push_back(-100);
 	}
-	for (int y = 0; y < HEIGHT; ++y) {
+	for (size_t y = 0; y < height; ++y) {
 		depthBuffer->emplace_back(smol);
 	}
 	return depthBuffer;
 }
 
 // Render the .obj file in the window
-void drawOBJ(Camera *camera, const float scalingFactor, std::vector<std::vector<float>> *depthBuffer, const std::vector<ModelTriangle>& triangles, DrawingWindow &window) {
+void drawOBJ(Camera *camera, std::vector<std::vector<float>> *depthBuffer, const std::vector<ModelTriangle>& triangles, DrawingWindow &window) {
 	CanvasTriangle renderTriangle;
 // #pragma omp parallel for
-	for (auto triangle: triangles) {
+	for (const auto &triangle: triangles) {
 		renderTriangle = {
-			projectVertexOntoCanvasPoint(camera, triangle.vertices[0], scalingFactor),
-			projectVertexOntoCanvasPoint(camera, triangle.vertices[1], scalingFactor),
-			projectVertexOntoCanvasPoint(camera, triangle.vertices[2], scalingFactor)
+			projectVertexOntoCanvasPoint(camera, triangle.vertices[0], window),
+			projectVertexOntoCanvasPoint(camera, triangle.vertices[1], window),
+			projectVertexOntoCanvasPoint(camera, triangle.vertices[2], window)
 		};
 		drawOccludedFilledTriangle(renderTriangle, triangle.colour, false, depthBuffer, window);
 	}
 }
 
-// Returns the closest triangle to the camera wrt a ray from the camera.
-std::pair<ModelTriangle, glm::vec3> getClosestIntersection(glm::vec3 fromPoint, glm::vec3 direction, const std::vector<ModelTriangle>& sceneTriangles) {
+// Returns the closest intersection wrt a ray, including the index of the triangle hit (sceneTriangles.size() if nothing was).
+// The triangles of a Scene are found by walking its BVH, any other list by testing every triangle. Equally close hits go
+// to the lower index either way, so both give what testing the triangles in order would.
+RayTriangleIntersection findClosestIntersection(glm::vec3 fromPoint, glm::vec3 direction, const std::vector<ModelTriangle>& sceneTriangles) {
 	glm::vec3 closestSoFar = {MAXFLOAT, MAXFLOAT, MAXFLOAT};
 	direction = direction * glm::mat3(glm::vec3(-1,0,0), glm::vec3(0,-1,0), glm::vec3(0,0,1));
-	ModelTriangle outTriangle;
-	for (ModelTriangle triangle: sceneTriangles) {
+	size_t outIndex = sceneTriangles.size();
+	// true if the triangle is the closest hit so far, with how far along -direction it was hit
+	auto test = [&](size_t index, float &along) {
+		const ModelTriangle &triangle = sceneTriangles[index];
 		glm::vec3 e0 = triangle.vertices[1] - triangle.vertices[0];
 		glm::vec3 e1 = triangle.vertices[2] - triangle.vertices[0];
 		glm::vec3 SPVector = fromPoint - triangle.vertices[0];
@@ -739,16 +773,39 @@ std::pair<ModelTriangle, glm::vec3> getClosestIntersection(glm::vec3 fromPoint,
 		glm::vec3 possibleSolution = inverse(DEMatrix) * SPVector;
 		glm::vec3 point = triangle.vertices[0] + possibleSolution.y*e0 + possibleSolution.z*e1;
 		if (possibleSolution.y >= 0.0 && possibleSolution.y <= 1.0 && possibleSolution.z >= 0.0 && possibleSolution.z <= 1.0 && possibleSolution.y + possibleSolution.z <= 1.0 && possibleSolution.x <= 0){
-			if (length(point - fromPoint) < length(closestSoFar - fromPoint )) {
+			float distance = length(point - fromPoint), closest = length(closestSoFar - fromPoint);
+			if (distance < closest || (distance == closest && index < outIndex)) {
 				closestSoFar = point;
-				outTriangle = triangle;
+				outIndex = index;
+				along = -possibleSolution.x;
+				return true;
 			}
 		}
-	}
-	return std::pair<ModelTriangle, glm::vec3>(outTriangle, closestSoFar);
+		return false;
+	};
+	const BVH *bvh = Scene::bvhFor(sceneTriangles);
+	if (bvh == nullptr) {
+		float along;
+		for (size_t index = 0; index < sceneTriangles.size(); index++) test(index, along);
+	} else {
+		float nearest = std::numeric_limits<float>::max();
+		bvh->traverse(fromPoint, -direction, nearest, [&](int index, float &nearestTriangle) {
+			float along;
+			// a little slack, so boxes holding a hit that rounds to the same distance are still walked for the tie break
+			if (test(index, along)) nearestTriangle = std::min(nearestTriangle, along * 1.001f);
+			return false;
+		});
+	}
+	return {closestSoFar, length(closestSoFar - fromPoint), outIndex < sceneTriangles.size() ? sceneTriangles[outIndex] : ModelTriangle(), outIndex};
 }
 
-float calculateProximityLighting(std::pair<ModelTriangle, glm::vec3> res, glm::vec3 point, const Light light, const std::vector<ModelTriangle> &triangles) {
+// Returns the closest triangle to the camera wrt a ray from the camera.
+std::pair<ModelTriangle, glm::vec3> getClosestIntersection(glm::vec3 fromPoint, glm::vec3 direction, const std::vector<ModelTriangle>& sceneTriangles) {
+	RayTriangleIntersection closest = findClosestIntersection(fromPoint, direction, sceneTriangles);
+	return std::pair<ModelTriangle, glm::vec3>(closest.intersectedTriangle, closest.intersectionPoint);
+}
+
+float calculateProximityLighting(const std::pair<ModelTriangle, glm::vec3> &res, glm::vec3 point, const Light &light, const std::vector<ModelTriangle> &triangles) {
 	float out = length(point - light.position) * length(point - light.position);
 	if (length(point - res.second) > 0.0000001) {
 		if (length(point - res.second) < length(point - light.position)) {
@@ -761,7 +818,7 @@ float calculateProximityLighting(std::pair<ModelTriangle, glm::vec3> res, glm::v
 	return result;
 }
 
-float calculateDiffuseLighting(std::pair<ModelTriangle, glm::vec3> res, Camera *camera, glm::vec3 point, Light light, const std::vector<ModelTriangle> &triangles) {
+float calculateDiffuseLighting(const std::pair<ModelTriangle, glm::vec3> &res, Camera *camera, glm::vec3 point, const Light &light, const std::vector<ModelTriangle> &triangles) {
 	auto normal = res.first.normal;
 	if (dot(camera->position - point, normal) < 0){
 		return 0;
@@ -777,7 +834,7 @@ float calculateDiffuseLighting(std::pair<ModelTriangle, glm::vec3> res, Camera *
 	return result;
 }
 
-float calculateDiffuseReflectionLighting(std::pair<ModelTriangle, glm::vec3> res, glm::vec3 from, glm::vec3 point, Light light, const std::vector<ModelTriangle> &triangles) {
+float calculateDiffuseReflectionLighting(const std::pair<ModelTriangle, glm::vec3> &res, glm::vec3 from, glm::vec3 point, const Light &light, const std::vector<ModelTriangle> &triangles) {
 	auto normal = res.first.normal;
 	if (dot(from - point, normal) < 0){
 		return 0;
@@ -793,7 +850,7 @@ float calculateDiffuseReflectionLighting(std::pair<ModelTriangle, glm::vec3> res
 	return result;
 }
 
-float calculateNormalDiffuseLighting(std::pair<ModelTriangle, glm::vec3> res, glm::vec3 point, glm::vec3 normal, Light light, const std::vector<ModelTriangle> &triangles) {
+float calculateNormalDiffuseLighting(const std::pair<ModelTriangle, glm::vec3> &res, glm::vec3 point, glm::vec3 normal, const Light &light, const std::vector<ModelTriangle> &triangles) {
 	float out = dot(normalize(light.position - res.second), normal);
 	if (length(point - res.second) > 0.01) {
 		if (length(point - res.second) < length(point - light.position)) {
@@ -806,7 +863,7 @@ float calculateNormalDiffuseLighting(std::pair<ModelTriangle, glm::vec3> res, gl
 }
 
 
-float calculateSpecularLighting(std::pair<ModelTriangle, glm::vec3> res, Camera *camera, glm::vec3 point, Light light, int power, const std::vector<ModelTriangle> &triangles) {
+float calculateSpecularLighting(const std::pair<ModelTriangle, glm::vec3> &res, Camera *camera, glm::vec3 point, const Light &light, int power, const std::vector<ModelTriangle> &triangles) {
 	auto normal = res.first.normal;
 	if (dot(camera->position - point, normal) < 0){
 		return 0;
@@ -824,7 +881,7 @@ float calculateSpecularLighting(std::pair<ModelTriangle, glm::vec3> res, Camera
 	return result;
 }
 
-float calculateSpecularReflectionLighting(std::pair<ModelTriangle, glm::vec3> res, glm::vec3 from, glm::vec3 point, Light light, int power, const std::vector<ModelTriangle> &triangles) {
+float calculateSpecularReflectionLighting(const std::pair<ModelTriangle, glm::vec3> &res, glm::vec3 from, glm::vec3 point, const Light &light, int power, const std::vector<ModelTriangle> &triangles) {
 	auto normal = res.first.normal;
 	if (dot(from - point, normal) < 0){
 		return 0;
@@ -842,7 +899,7 @@ float calculateSpecularReflectionLighting(std::pair<ModelTriangle, glm::vec3> re
 	return result;
 }
 
-float calculateNormalSpecularLighting(std::pair<ModelTriangle, glm::vec3> res, Camera *camera, glm::vec3 point, glm::vec3 normal, Light light, int power, const std::vector<ModelTriangle> &triangles) {
+float calculateNormalSpecularLighting(const std::pair<ModelTriangle, glm::vec3> &res, Camera *camera, glm::vec3 point, glm::vec3 normal, const Light &light, int power, const std::vector<ModelTriangle> &triangles) {
 	glm::vec3 Ri = normalize(point - light.position);
 	if (dot(camera->position - point, normal) < 0) {
 		return 0;
@@ -859,7 +916,7 @@ float calculateNormalSpecularLighting(std::pair<ModelTriangle, glm::vec3> res, C
 	return result;
 }
 
-float calculateRaytracedLighting(Camera *camera, glm::vec3 point, const Light light, const std::vector<ModelTriangle> &triangles) {
+float calculateRaytracedLighting(Camera *camera, glm::vec3 point, const Light &light, const std::vector<ModelTriangle> &triangles) {
 	point = point + 0.001 * normalize(light.position - point)* glm::mat3(glm::vec3(1,0,0), glm::vec3(0,1,0), glm::vec3(0,0,-1));
 	std::pair<ModelTriangle, glm::vec3> res = getClosestIntersection(point, normalize(point - light.position), triangles);
 	float ambientWeight = 0.2;
@@ -870,7 +927,7 @@ float calculateRaytracedLighting(Camera *camera, glm::vec3 point, const Light li
 	return final;
 }
 
-float calculateReflectionLighting(glm::vec3 from, glm::vec3 point, const Light light, const std::vector<ModelTriangle> &triangles) {
+float calculateReflectionLighting(glm::vec3 from, glm::vec3 point, const Light &light, const std::vector<ModelTriangle> &triangles) {
 	point = point + 0.001 * normalize(light.position - point)* glm::mat3(glm::vec3(1,0,0), glm::vec3(0,1,0), glm::vec3(0,0,-1));
 	std::pair<ModelTriangle, glm::vec3> res = getClosestIntersection(point, normalize(point - light.position), triangles);
 	float ambientWeight = 0.2;
@@ -881,7 +938,7 @@ float calculateReflectionLighting(glm::vec3 from, glm::vec3 point, const Light l
 	return final;
 }
 
-float calculateNormalRaytracedLighting(Camera *camera, glm::vec3 point, const glm::vec3 normal, const Light light, const std::vector<ModelTriangle> &triangles) {
+float calculateNormalRaytracedLighting(Camera *camera, glm::vec3 point, const glm::vec3 normal, const Light &light, const std::vector<ModelTriangle> &triangles) {
 	point = point + 0.001 * normalize(light.position - point)* glm::mat3(glm::vec3(1,0,0), glm::vec3(0,1,0), glm::vec3(0,0,-1));
 	std::pair<ModelTriangle, glm::vec3> res = getClosestIntersection(point, normalize(point - light.position), triangles);
 	float ambientWeight = 0.3;
@@ -893,10 +950,10 @@ float calculateNormalRaytracedLighting(Camera *camera, glm::vec3 point, const gl
 	return final;
 }
 
-float calculateGouraudLighting(Camera *camera, glm::vec3 point, Light light, const std::vector<ModelTriangle> &triangles) {
+float calculateGouraudLighting(Camera *camera, glm::vec3 point, const Light &light, const std::vector<ModelTriangle> &triangles) {
 	auto cipoint = point + 0.001 * normalize(light.position - point)* glm::mat3(glm::vec3(1,0,0), glm::vec3(0,1,0), glm::vec3(0,0,-1));
 	std::pair<ModelTriangle, glm::vec3> res = getClosestIntersection(cipoint, normalize(cipoint - light.position), triangles);
-	auto triangle = res.first;
+	const auto &triangle = res.first;
 	auto normal1 = calculateVertexNormal(triangle.vertices[0], triangles);
 	auto normal2 = calculateVertexNormal(triangle.vertices[1], triangles);
 	auto normal3 = calculateVertexNormal(triangle.vertices[2], triangles);
@@ -911,10 +968,10 @@ float calculateGouraudLighting(Camera *camera, glm::vec3 point, Light light, con
 	return vb0 * weights[0] + vb1 * weights[1] + vb2 * weights[2];
 }
 
-float calculatePhongLighting(Camera *camera, glm::vec3 point, Light light, const std::vector<ModelTriangle> &triangles) {
+float calculatePhongLighting(Camera *camera, glm::vec3 point, const Light &light, const std::vector<ModelTriangle> &triangles) {
 	auto cipoint = point + 0.001 * normalize(light.position - point)* glm::mat3(glm::vec3(1,0,0), glm::vec3(0,1,0), glm::vec3(0,0,-1));
 	std::pair<ModelTriangle, glm::vec3> res = getClosestIntersection(cipoint, normalize(cipoint - light.position), triangles);
-	auto triangle = res.first;
+	const auto &triangle = res.first;
 	auto vn0 = calculateVertexNormal(triangle.vertices[0], triangles);
 	auto vn1 = calculateVertexNormal(triangle.vertices[1], triangles);
 	auto vn2 = calculateVertexNormal(triangle.vertices[2], triangles);
@@ -923,6 +980,69 @@ float calculatePhongLighting(Camera *camera, glm::vec3 point, Light light, const
 	return calculateNormalRaytracedLighting(camera, point, normal, light, triangles);
 }
 
+// Shadow rays only need to know whether anything is in the way, so stop at the first triangle between the two points.
+// Unlike findClosestIntersection this takes the segment in world space, with no direction flip.
+bool isOccluded(const glm::vec3 from, const glm::vec3 to, const std::vector<ModelTriangle> &triangles) {
+	const glm::vec3 direction = to - from;
+	auto blocks = [&](const ModelTriangle &triangle) {
+		glm::vec3 e0 = triangle.vertices[1] - triangle.vertices[0];
+		glm::vec3 e1 = triangle.vertices[2] - triangle.vertices[0];
+		glm::vec3 p = cross(direction, e1);
+		float determinant = dot(e0, p);
+		if (std::abs(determinant) < 1e-9f) return false;
+		float inverse = 1 / determinant;
+		glm::vec3 s = from - triangle.vertices[0];
+		float u = dot(s, p) * inverse;
+		if (u < 0 || u > 1) return false;
+		glm::vec3 q = cross(s, e0);
+		float v = dot(direction, q) * inverse;
+		if (v < 0 || u + v > 1) return false;
+		float t = dot(e1, q) * inverse;
+		return t > 0.001f && t < 0.999f;
+	};
+	const BVH *bvh = Scene::bvhFor(triangles);
+	if (bvh == nullptr) return std::any_of(triangles.begin(), triangles.end(), blocks);
+	float nearest = 1;
+	return bvh->traverse(from, direction, nearest, [&](int index, float &) {
+		return blocks(triangles[index]);
+	});
+}
+
+// Soft shadowed lighting from an area light: the fraction of the light visible from the point blends between the
+// lit and shadowed versions of calculateRaytracedLighting's terms, using samples on a jittered (stratified) grid
+float calculateAreaLighting(Camera *camera, glm::vec3 point, glm::vec3 normal, const Light &light, const std::vector<ModelTriangle> &triangles, const int samples, Random &random) {
+	if (dot(camera->position - point, normal) < 0) normal = -normal;
+	glm::vec3 origin = point + 0.001f * normal;
+	// the grid is columns x rows with exactly samples cells, as close to square as samples' divisors allow
+	const int cells = std::max(1, samples);
+	int columns = static_cast<int>(std::sqrt(static_cast<float>(cells)));
+	while (cells % columns != 0) columns--;
+	const int rows = cells / columns;
+	int visible = 0;
+	for (int a = 0; a < columns; a++) {
+		for (int b = 0; b < rows; b++) {
+			glm::vec3 target = light.samplePoint((a + random.next()) / columns, (b + random.next()) / rows);
+			if (!isOccluded(origin, target, triangles)) visible++;
+		}
+	}
+	float visibility = static_cast<float>(visible) / cells;
+	glm::vec3 toLight = light.position - point;
+	float distanceSquared = dot(toLight, toLight);
+	toLight = normalize(toLight);
+	float ambientWeight = 0.2;
+	float prox = std::min(1.0f, light.intensity / distanceSquared);
+	float diff = std::sqrt(std::max(0.0f, dot(toLight, normal)));
+	float comb = (1-ambientWeight)*(-(prox*diff)*(prox*diff) + 2 * prox*diff) + ambientWeight;
+	glm::vec3 Rr = -toLight + 2 * normal * dot(toLight, normal);
+	float spec = std::pow(std::max(0.0f, dot(normalize(camera->position - point), Rr)), 16.0f);
+	float lit = 0.8 * comb + 0.2 * std::min(1.0f, spec);
+	// in shadow only the quartered falloff and the 0.2 diffuse floor remain, as with the point light
+	float shadowProx = std::min(1.0f, light.intensity / (4 * distanceSquared));
+	float shadowDiff = std::sqrt(0.2f);
+	float shadowed = 0.8 * ((1-ambientWeight)*(-(shadowProx*shadowDiff)*(shadowProx*shadowDiff) + 2 * shadowProx*shadowDiff) + ambientWeight);
+	return visibility * lit + (1 - visibility) * shadowed;
+}
+
 Colour getTextureMappedColour(const std::vector<std::vector<TexturePoint>> &texture, const glm::vec3 triangleCoords, const ModelTriangle &triangle, const std::array<TexturePoint, 3> &textureCoords) {
 	auto weights = baryFromVec3(triangleCoords, triangle);
 	TexturePoint onTexture = texturePointFromBary(weights, textureCoords);
@@ -930,75 +1050,550 @@ Colour getTextureMappedColour(const std::vector<std::vector<TexturePoint>> &text
 	return toPaint.colour;
 }
 
-Colour getReflectionColour(Camera *camera, std::vector<std::vector<TexturePoint>> texture, glm::vec3 point, Light *light, ModelTriangle triangle, std::vector<ModelTriangle> triangles){
-	glm::vec3 Ri = normalize(point - camera->position);
-	glm::vec3 Rr = normalize(Ri - 2*triangle.normal*dot(Ri, triangle.normal)) * glm::mat3(glm::vec3(1,0,0), glm::vec3(0,1,0), glm::vec3(0,0,-1));
-	point = point + 0.001 * normalize(light->position - point);
-	std::pair<ModelTriangle, glm::vec3> res = getClosestIntersection(point, Rr, triangles);
-	auto weighting = calculateReflectionLighting(point, res.second, *light, triangles);
-	return res.first.colour * weighting;
+// Lighting at a point from every light in the set, without paying for all of them. Lights out of range are skipped;
+// if no more than settings.lightSamples are left they are all summed, otherwise that many are picked in proportion to
+// their unshadowed contribution and each is weighted by how unlikely it was. ambient is the floor each lighting
+// function adds once whichever light it is given, so only the rest is summed or scaled, after fading it towards the
+// light's range.
+template <typename Lighting>
+float sampleLights(const LightSet &lights, const glm::vec3 point, const float ambient, const RenderSettings &settings, Random &random, Lighting lighting) {
+	size_t reachable = 0;
+	size_t only = 0;
+	for (size_t i = 0; i < lights.lights.size(); i++) {
+		if (lights.weight(i, point) > 0) {
+			reachable++;
+			only = i;
+		}
+	}
+	auto faded = [&](const Light &light) {
+		return (lighting(light) - ambient) * light.fade(point);
+	};
+	if (reachable == 0) return ambient;
+	if (reachable == 1) {
+		const Light &light = lights.lights[only];
+		return light.fade(point) < 1 ? std::max(0.0f, ambient + faded(light)) : lighting(light);
+	}
+	const int picks = std::max(1, settings.lightSamples);
+	float total = 0;
+	if (reachable <= static_cast<size_t>(picks)) {
+		total = ambient;
+		for (size_t i = 0; i < lights.lights.size(); i++) {
+			if (lights.weight(i, point) > 0) total += faded(lights.lights[i]);
+		}
+		return std::max(0.0f, total);
+	}
+	for (int i = 0; i < picks; i++) {
+		float probability;
+		size_t index = lights.choose(point, random.next(), probability);
+		total += ambient + faded(lights.lights[index]) / probability;
+	}
+	return std::max(0.0f, total / picks);
 }
 
-void drawRaytraceOBJ(Camera *camera, float scalingFactor, const std::vector<std::vector<TexturePoint>>& texture, const std::vector<ModelTriangle>& triangles, Light *light, DrawingWindow &window) {
-	float step = 0.00622;
+// Mirrors are the magenta surfaces in the reflective modes
+bool isMirror(const std::string &mode, const ModelTriangle &triangle) {
+	return (mode == "RAYTRACE_R" || mode == "RAYTRACE_G" || mode == "HYBRID" || mode == "PATHTRACE") && triangle.colour == Colour(255,0,255);
+}
+
+// In the glass mode the blue box is made of glass
+bool isGlass(const std::string &mode, const ModelTriangle &triangle) {
+	return mode == "RAYTRACE_G" && triangle.colour == Colour(0,0,255);
+}
+
+// Pushes the continuations of a ray that hit a mirror or glass surface: the mirror bounce, or for glass the
+// Fresnel weighted reflection plus the refracted ray (or just the reflection under total internal reflection)
+void scatterSecondaryRays(const SecondaryRay &ray, const glm::vec3 point, const ModelTriangle &triangle, const glm::vec3 tint, const RenderSettings &settings, const std::string &mode, RayStack &stack) {
+	glm::vec3 facing = dot(ray.direction, triangle.normal) < 0 ? triangle.normal : -triangle.normal;
+	glm::vec3 reflected = normalize(ray.direction - 2 * facing * dot(ray.direction, facing));
+	if (isMirror(mode, triangle)) {
+		stack.push({point + 0.001f * facing, reflected, ray.throughput * tint, ray.depth + 1, ray.inside});
+		return;
+	}
+	float eta = ray.inside ? settings.refractiveIndex : 1 / settings.refractiveIndex;
+	glm::vec3 refracted = glm::refract(ray.direction, facing, eta);
+	if (refracted == glm::vec3(0, 0, 0)) {
+		stack.push({point + 0.001f * facing, reflected, ray.throughput * tint, ray.depth + 1, ray.inside});
+		return;
+	}
+	// Schlick's approximation of the Fresnel reflectance
+	float r0 = (1 - settings.refractiveIndex) / (1 + settings.refractiveIndex);
+	r0 = r0 * r0;
+	float fresnel = r0 + (1 - r0) * std::pow(1 + dot(ray.direction, facing), 5.0f);
+	stack.push({point + 0.001f * facing, reflected, ray.throughput * tint * fresnel, ray.depth + 1, ray.inside});
+	stack.push({point - 0.001f * facing, normalize(refracted), ray.throughput * tint * (1 - fresnel), ray.depth + 1, !ray.inside});
+}
+
+// Follows every mirror and glass bounce leaving a primary hit, with an explicit fixed-size ray stack instead of recursion.
+// Paths end on a diffuse surface, at settings.maxDepth, or by Russian roulette once they are deeper than settings.rouletteDepth.
+Colour traceSecondaryRays(Camera *camera, const glm::vec3 point, const ModelTriangle &surface, const float surfaceLighting, const LightSet &lights, const std::vector<ModelTriangle> &triangles, const RenderSettings &settings, Random &random) {
+	const glm::mat3 flip = glm::mat3(glm::vec3(1,0,0), glm::vec3(0,1,0), glm::vec3(0,0,-1));
+	RayStack stack;
+	glm::vec3 colour = {0, 0, 0};
+	// mirrors are tinted by their own shading, glass lets most light through with a hint of its colour
+	glm::vec3 tint = isGlass(camera->mode, surface) ? 0.7f + 0.3f * glm::vec3(surface.colour.red, surface.colour.green, surface.colour.blue) / 255.0f : glm::vec3(surfaceLighting);
+	SecondaryRay primary = {camera->position, normalize(point - camera->position), glm::vec3(1, 1, 1), 0, false};
+	scatterSecondaryRays(primary, point, surface, tint, settings, camera->mode, stack);
+	while (!stack.empty()) {
+		SecondaryRay ray = stack.pop();
+		if (ray.depth > settings.rouletteDepth) {
+			float survival = std::min(1.0f, std::max({ray.throughput.x, ray.throughput.y, ray.throughput.z}));
+			if (random.next() >= survival) continue;
+			ray.throughput /= survival;
+		}
+		RayTriangleIntersection hit = findClosestIntersection(ray.origin, flip * ray.direction, triangles);
+		if (hit.triangleIndex >= triangles.size()) continue;
+		const ModelTriangle &triangle = triangles[hit.triangleIndex];
+		bool glass = isGlass(camera->mode, triangle);
+		if ((glass || isMirror(camera->mode, triangle)) && ray.depth < settings.maxDepth) {
+			glm::vec3 hitTint = glass ? 0.7f + 0.3f * glm::vec3(triangle.colour.red, triangle.colour.green, triangle.colour.blue) / 255.0f : glm::vec3(sampleLights(lights, hit.intersectionPoint, 0.16f, settings, random, [&](const Light &light) {
+				return calculateReflectionLighting(ray.origin, hit.intersectionPoint, light, triangles);
+			}));
+			scatterSecondaryRays(ray, hit.intersectionPoint, triangle, hitTint, settings, camera->mode, stack);
+			continue;
+		}
+		float lighting = sampleLights(lights, hit.intersectionPoint, 0.16f, settings, random, [&](const Light &light) {
+			return calculateReflectionLighting(ray.origin, hit.intersectionPoint, light, triangles);
+		});
+		colour += ray.throughput * glm::vec3(triangle.colour.red, triangle.colour.green, triangle.colour.blue) * lighting;
+	}
+	colour = glm::min(colour, glm::vec3(255, 255, 255));
+	return {static_cast<int>(colour.x), static_cast<int>(colour.y), static_cast<int>(colour.z)};
+}
+
+// Traces the primary ray through the point (x, y) of a width x height frame into a G-buffer sample.
+// Pixel centres are at half-integer coordinates; (i, j) is the offset from the centre of the view, up and to the left.
+void tracePrimaryRay(Camera *camera, const float x, const float y, const size_t width, const size_t height, const std::vector<ModelTriangle>& triangles, GBufferSample &sample) {
+	float step = 1 / camera->pixelScale(height);
+	float i = width / 2.0f - x, j = height / 2.0f - y;
+	glm::vec3 pixel = camera->position + camera->orientation[0] * step * i - camera->orientation[1] * step * j + camera->focalLength * - camera->orientation[2];
+	RayTriangleIntersection closest = findClosestIntersection(camera->position, normalize(camera->position - pixel), triangles);
+	sample.valid = true;
+	sample.hit = closest.triangleIndex < triangles.size();
+	sample.triangleIndex = closest.triangleIndex;
+	sample.position = closest.intersectionPoint;
+	sample.depth = closest.distanceFromCamera;
+	if (sample.hit) {
+		sample.normal = closest.intersectedTriangle.normal;
+		sample.barycentric = baryFromVec3(closest.intersectionPoint, closest.intersectedTriangle);
+		sample.colour = closest.intersectedTriangle.colour;
+	}
+}
+
+// The primary ray through pixel offset (i, j) of a frame height pixels tall leaves the camera along primaryRayBasis * (i, j, 1).
+// This folds in the axis flip that findClosestIntersection applies to every ray direction.
+glm::mat3 primaryRayBasis(Camera *camera, const size_t height) {
+	float step = 1 / camera->pixelScale(height);
+	glm::mat3 flip = glm::mat3(glm::vec3(1,0,0), glm::vec3(0,1,0), glm::vec3(0,0,-1));
+	return {flip * camera->orientation[0] * -step, flip * camera->orientation[1] * step, flip * camera->orientation[2] * camera->focalLength};
+}
+
+// A vertex in ray space (i*z, j*z, z) along with the barycentric coords it has on the original triangle
+struct VisibilityVertex {
+	glm::vec3 rayPosition;
+	glm::vec3 barycentric;
+};
+
+// Scan converts one near-clipped triangle into the G-buffer with perspective correct barycentrics and a depth test
+void rasteriseVisibilityTriangle(const std::array<VisibilityVertex, 3> &vertices, const size_t index, const ModelTriangle &triangle, Camera *camera, GBuffer *gbuffer) {
+	std::array<glm::vec2, 3> screen;
+	std::array<float, 3> inverseDepth;
+	for (int k=0; k<3; k++) {
+		inverseDepth[k] = 1 / vertices[k].rayPosition.z;
+		screen[k] = glm::vec2(vertices[k].rayPosition.x, vertices[k].rayPosition.y) * inverseDepth[k];
+	}
+	auto edge = [](const glm::vec2 &a, const glm::vec2 &b, const glm::vec2 &p) { return (b.x - a.x) * (p.y - a.y) - (b.y - a.y) * (p.x - a.x); };
+	float area = edge(screen[0], screen[1], screen[2]);
+	if (area == 0) return;
+	// pixel x is traced with i = width/2 - (x + 0.5), so the i range maps onto a reversed x range (likewise for y)
+	const int width = gbuffer->width, height = gbuffer->height;
+	float minI = std::min({screen[0].x, screen[1].x, screen[2].x}), maxI = std::max({screen[0].x, screen[1].x, screen[2].x});
+	float minJ = std::min({screen[0].y, screen[1].y, screen[2].y}), maxJ = std::max({screen[0].y, screen[1].y, screen[2].y});
+	int fromX = std::max(0, static_cast<int>(std::ceil(width/2.0f - 0.5f - maxI))), toX = std::min(width-1, static_cast<int>(std::floor(width/2.0f - 0.5f - minI)));
+	int fromY = std::max(0, static_cast<int>(std::ceil(height/2.0f - 0.5f - maxJ))), toY = std::min(height-1, static_cast<int>(std::floor(height/2.0f - 0.5f - minJ)));
+	for (int y=fromY; y<=toY; y++) {
+		for (int x=fromX; x<=toX; x++) {
+			glm::vec2 p = glm::vec2(width/2.0f - (x + 0.5f), height/2.0f - (y + 0.5f));
+			float e0 = edge(screen[1], screen[2], p) / area;
+			float e1 = edge(screen[2], screen[0], p) / area;
+			float e2 = 1 - e0 - e1;
+			if (e0 < 0 || e1 < 0 || e2 < 0) continue;
+			float weight = e0 * inverseDepth[0] + e1 * inverseDepth[1] + e2 * inverseDepth[2];
+			glm::vec3 barycentric = (e0 * inverseDepth[0] * vertices[0].barycentric + e1 * inverseDepth[1] * vertices[1].barycentric + e2 * inverseDepth[2] * vertices[2].barycentric) / weight;
+			glm::vec3 position = barycentric.x * triangle.vertices[0] + barycentric.y * triangle.vertices[1] + barycentric.z * triangle.vertices[2];
+			float depth = length(position - camera->position);
+			GBufferSample &sample = gbuffer->at(x, y);
+			if (sample.hit && sample.depth <= depth) continue;
+			sample.hit = true;
+			sample.triangleIndex = index;
+			sample.position = position;
+			sample.depth = depth;
+			sample.normal = triangle.normal;
+			sample.barycentric = barycentric;
+			sample.colour = triangle.colour;
+		}
+	}
+}
+
+// Fills the whole G-buffer by rasterising the triangles rather than tracing a primary ray per pixel.
+// Vertices are projected with the inverse of the primary ray mapping, so each pixel gets the hit its ray would.
+void rasterisePrimaryVisibility(Camera *camera, const std::vector<ModelTriangle>& triangles, GBuffer *gbuffer) {
+	const glm::mat3 toRaySpace = inverse(primaryRayBasis(camera, gbuffer->height));
+	const float near = 0.0001;
+	const std::array<glm::vec3, 3> corners = {glm::vec3(1,0,0), glm::vec3(0,1,0), glm::vec3(0,0,1)};
+	for (auto &sample : gbuffer->samples) {
+		sample.valid = true;
+		sample.hit = false;
+	}
+	for (size_t index = 0; index < triangles.size(); index++) {
+		const ModelTriangle &triangle = triangles[index];
+		std::array<VisibilityVertex, 3> projected;
+		for (int k=0; k<3; k++) {
+			projected[k] = {toRaySpace * (triangle.vertices[k] - camera->position), corners[k]};
+		}
+		// clip against the near plane, which turns the triangle into a polygon of at most four vertices
+		std::array<VisibilityVertex, 4> polygon;
+		int count = 0;
+		for (int k=0; k<3; k++) {
+			const VisibilityVertex &current = projected[k];
+			const VisibilityVertex &next = projected[(k+1)%3];
+			if (current.rayPosition.z >= near) polygon[count++] = current;
+			if ((current.rayPosition.z >= near) != (next.rayPosition.z >= near)) {
+				float t = (near - current.rayPosition.z) / (next.rayPosition.z - current.rayPosition.z);
+				polygon[count++] = {glm::mix(current.rayPosition, next.rayPosition, t), glm::mix(current.barycentric, next.barycentric, t)};
+			}
+		}
+		for (int k=1; k+1<count; k++) {
+			rasteriseVisibilityTriangle({polygon[0], polygon[k], polygon[k+1]}, index, triangle, camera, gbuffer);
+		}
+	}
+	gbuffer->complete = true;
+}
+
+// Lighting from one light in the box modes: area lights get soft shadows, the point light keeps its original model
+float boxLighting(Camera *camera, const GBufferSample &sample, const Light &light, const std::vector<ModelTriangle>& triangles, const RenderSettings &settings, Random &random) {
+	if (light.area()) {
+		return calculateAreaLighting(camera, sample.position, sample.normal, light, triangles, settings.shadowSamplesFor(camera->mode), random);
+	}
+	if (camera->mode == "RAYTRACE_P") { // this is inefficient
+		glm::vec3 point = sample.position;
+		point = point + 0.001 * normalize(light.position - point)* glm::mat3(glm::vec3(1,0,0), glm::vec3(0,1,0), glm::vec3(0,0,-1));
+		std::pair<ModelTriangle, glm::vec3> res = getClosestIntersection(point, normalize(point - light.position), triangles);
+		return calculateProximityLighting(res, point, light, triangles);
+	}
+	return calculateRaytracedLighting(camera, sample.position, light, triangles);
+}
+
+// Shades a traced G-buffer sample according to the camera mode; only the shadow and reflection rays are cast here
+Colour shadeSample(Camera *camera, const GBufferSample &sample, const std::vector<std::vector<TexturePoint>>& texture, const std::vector<ModelTriangle>& triangles, const LightSet &lights, const RenderSettings &settings, Random &random) {
+	if (!sample.hit) return {0, 0, 0};
+	std::pair<ModelTriangle, glm::vec3> toPaint = {triangles[sample.triangleIndex], sample.position};
+	if (camera->mode == "SPHERE_G" || camera->mode == "SPHERE_P") {
+		// the sphere modes shade from vertex normals and treat every light as a point
+		auto lighting = sampleLights(lights, toPaint.second, 0.24f, settings, random, [&](const Light &light) {
+			if (camera->mode == "SPHERE_G") return calculateGouraudLighting(camera, toPaint.second, light, triangles);
+			return calculatePhongLighting(camera, toPaint.second, light, triangles);
+		});
+		return toPaint.first.colour * lighting;
+	}
+	// proximity lighting has no ambient floor, the other box modes all add 0.8 * 0.2
+	float ambient = camera->mode == "RAYTRACE_P" ? 0 : 0.16f;
+	auto lighting = sampleLights(lights, toPaint.second, ambient, settings, random, [&](const Light &light) {
+		return boxLighting(camera, sample, light, triangles, settings, random);
+	});
+	if (camera->mode == "RAYTRACE_TM" && toPaint.first.colour == Colour(0,255,0)) {
+		return getTextureMappedColour(texture, toPaint.second, toPaint.first,toPaint.first.texturePoints) * lighting;
+	}
+	if (isMirror(camera->mode, toPaint.first) || isGlass(camera->mode, toPaint.first)) {
+		return traceSecondaryRays(camera, toPaint.second, toPaint.first, lighting, lights, triangles, settings, random);
+	}
+	return toPaint.first.colour * lighting;
+}
+
+// Shades pixel (x, y), tracing its primary ray first unless the G-buffer already holds it
+Colour raytracePixel(Camera *camera, const int x, const int y, const std::vector<std::vector<TexturePoint>>& texture, const std::vector<ModelTriangle>& triangles, const LightSet &lights, const RenderSettings &settings, GBuffer *gbuffer) {
+	GBufferSample &sample = gbuffer->at(x, y);
+	if (!sample.valid) tracePrimaryRay(camera, x + 0.5f, y + 0.5f, gbuffer->width, gbuffer->height, triangles, sample);
+	Random random = Random(Random::seedFor(x, y, 0));
+	return shadeSample(camera, sample, texture, triangles, lights, settings, random);
+}
+
+// True when an edge runs between two neighbouring pixels. The G-buffer finds the geometric ones: one pixel misses, the
+// depth jumps, or the neighbours sit on triangles that bend sharply or change material. Two triangles of one flat wall
+// aren't an edge on their own; the colour test catches what the G-buffer can't see, like shadow boundaries and textures.
+bool isEdgeBetween(const GBufferSample &a, uint32_t colourA, const GBufferSample &b, uint32_t colourB, const RenderSettings &settings) {
+	if (a.hit != b.hit) return true;
+	if (a.hit && std::abs(a.depth - b.depth) > settings.depthThreshold * std::min(std::abs(a.depth), std::abs(b.depth))) return true;
+	// the models don't agree on winding, so a normal pointing the other way is the same plane
+	if (a.hit && a.triangleIndex != b.triangleIndex && (std::abs(dot(a.normal, b.normal)) < settings.normalThreshold || !(a.colour == b.colour))) return true;
+	for (int shift = 0; shift <= 16; shift += 8) {
+		if (std::abs(int((colourA >> shift) & 0xFF) - int((colourB >> shift) & 0xFF)) > settings.colourThreshold) return true;
+	}
+	return false;
+}
+
+// Adaptive anti-aliasing: after the one ray per pixel pass, pixels on an edge (see isEdgeBetween) get settings.antialiasSamples
+// more primary rays on a rotated grid and are averaged with their centre sample, everything else stays at one sample.
+// Returns how many pixels were supersampled.
+int supersampleEdges(Camera *camera, const std::vector<std::vector<TexturePoint>>& texture, const std::vector<ModelTriangle>& triangles, const LightSet &lights, const RenderSettings &settings, GBuffer *gbuffer, DrawingWindow &window) {
+	const int width = window.width, height = window.height;
+	FrameVector<uint8_t> edges(width * height, 0);
 #pragma omp parallel for
-	for (int i=-WIDTH/2; i<WIDTH/2; i++) {
-		for (int j=-HEIGHT/2; j<HEIGHT/2; j++) {//right, up, forward
-			glm::vec3 pixel = camera->position + camera->orientation[0] * step * i - camera->orientation[1] * step * j + camera->focalLength * - camera->orientation[2];
-			std::pair<ModelTriangle, glm::vec3> toPaint = getClosestIntersection(camera->position, normalize(camera->position - pixel), triangles);
-			if (camera->mode == "RAYTRACE_P") { // this is inefficient
-				glm::vec3 point = toPaint.second;
-				point = point + 0.001 * normalize(light->position - point)* glm::mat3(glm::vec3(1,0,0), glm::vec3(0,1,0), glm::vec3(0,0,-1));
-				std::pair<ModelTriangle, glm::vec3> res = getClosestIntersection(point, normalize(point - light->position), triangles);
-				window.setPixelColour(WIDTH/2-i, HEIGHT/2-j, (toPaint.first.colour * calculateProximityLighting(res, point, *light, triangles)).asARGB());
-			} else if (camera->mode == "RAYTRACE_D") {
-				auto lighting = calculateRaytracedLighting(camera, toPaint.second, *light, triangles);
-				window.setPixelColour(WIDTH/2-i, HEIGHT/2-j, (toPaint.first.colour * lighting).asARGB());
-			} else if (camera->mode == "SPHERE_G") {
-				auto lighting = calculateGouraudLighting(camera, toPaint.second, *light, triangles);
-				window.setPixelColour(WIDTH/2-i, HEIGHT/2-j, (toPaint.first.colour * lighting).asARGB());
-			} else if (camera->mode == "SPHERE_P") {
-				auto lighting = calculatePhongLighting(camera, toPaint.second, *light, triangles);
-				window.setPixelColour(WIDTH/2-i, HEIGHT/2-j, (toPaint.first.colour * lighting).asARGB());
-			} else if (camera->mode == "RAYTRACE_TM") {
-				auto lighting = calculateRaytracedLighting(camera, toPaint.second, *light, triangles);
-				if (toPaint.first.colour == Colour(0,255,0)) {
-					window.setPixelColour(WIDTH/2-i, HEIGHT/2-j, (getTextureMappedColour(texture, toPaint.second, toPaint.first,toPaint.first.texturePoints) *lighting).asARGB());
-				} else {
-					window.setPixelColour(WIDTH/2-i, HEIGHT/2-j, (toPaint.first.colour * lighting).asARGB());
+	for (int y = 0; y < height; y++) {
+		for (int x = 0; x < width; x++) {
+			const GBufferSample &sample = gbuffer->at(x, y);
+			uint32_t colour = window.getPixelColour(x, y);
+			bool edge = false;
+			if (x + 1 < width) edge = edge || isEdgeBetween(sample, colour, gbuffer->at(x + 1, y), window.getPixelColour(x + 1, y), settings);
+			if (x > 0) edge = edge || isEdgeBetween(sample, colour, gbuffer->at(x - 1, y), window.getPixelColour(x - 1, y), settings);
+			if (y + 1 < height) edge = edge || isEdgeBetween(sample, colour, gbuffer->at(x, y + 1), window.getPixelColour(x, y + 1), settings);
+			if (y > 0) edge = edge || isEdgeBetween(sample, colour, gbuffer->at(x, y - 1), window.getPixelColour(x, y - 1), settings);
+			edges[y * width + x] = edge;
+		}
+	}
+	// rotated grid offsets in pixels, so no two samples share a row or column
+	const glm::vec2 offsets[] = {glm::vec2(-0.125, -0.375), glm::vec2(0.375, -0.125), glm::vec2(0.125, 0.375), glm::vec2(-0.375, 0.125)};
+	const int samples = std::max(1, std::min(4, settings.antialiasSamples));
+	int supersampled = 0;
+#pragma omp parallel for reduction(+:supersampled)
+	for (int y = 0; y < height; y++) {
+		for (int x = 0; x < width; x++) {
+			if (!edges[y * width + x]) continue;
+			uint32_t centre = window.getPixelColour(x, y);
+			glm::vec3 sum = glm::vec3((centre >> 16) & 0xFF, (centre >> 8) & 0xFF, centre & 0xFF);
+			for (int k = 0; k < samples; k++) {
+				GBufferSample sub = GBufferSample();
+				tracePrimaryRay(camera, x + 0.5f + offsets[k].x, y + 0.5f + offsets[k].y, width, height, triangles, sub);
+				Random random = Random(Random::seedFor(x, y, k + 1));
+				Colour colour = shadeSample(camera, sub, texture, triangles, lights, settings, random);
+				sum += glm::vec3(colour.red, colour.green, colour.blue);
+			}
+			sum /= float(samples + 1);
+			window.setPixelColour(x, y, Colour(int(std::round(sum.r)), int(std::round(sum.g)), int(std::round(sum.b))).asARGB());
+			supersampled++;
+		}
+	}
+	return supersampled;
+}
+
+void drawRaytraceOBJ(Camera *camera, const std::vector<std::vector<TexturePoint>>& texture, const std::vector<ModelTriangle>& triangles, const LightSet &lights, const RenderSettings &settings, GBuffer *gbuffer, DrawingWindow &window) {
+	gbuffer->useScene(triangles);
+#pragma omp parallel for
+	for (int y=0; y<static_cast<int>(window.height); y++) {
+		for (int x=0; x<static_cast<int>(window.width); x++) {
+			window.setPixelColour(x, y, raytracePixel(camera, x, y, texture, triangles, lights, settings, gbuffer).asARGB());
+		}
+	}
+	gbuffer->supersampledPixels = settings.antialias ? supersampleEdges(camera, texture, triangles, lights, settings, gbuffer, window) : 0;
+}
+
+// Runs the next pass of a progressive raytrace: traces the pixels on this pass's stride grid and
+// paints each one over its stride x stride block, so the frame starts blocky and sharpens while the camera is still.
+// The stride-1 pass leaves every pixel holding its own sample, so that's when the edges are anti-aliased.
+void drawProgressiveRaytraceOBJ(Camera *camera, const std::vector<std::vector<TexturePoint>>& texture, const std::vector<ModelTriangle>& triangles, const LightSet &lights, const RenderSettings &settings, ProgressiveRefinement *progressive, GBuffer *gbuffer, DrawingWindow &window) {
+	gbuffer->useScene(triangles);
+	if (progressive->finished()) return;
+	const int stride = progressive->stride;
+	const int width = window.width, height = window.height;
+#pragma omp parallel for
+	for (int y=0; y<height; y+=stride) {
+		for (int x=0; x<width; x+=stride) {
+			if (!progressive->shouldTrace(x, y)) continue;
+			uint32_t colour = raytracePixel(camera, x, y, texture, triangles, lights, settings, gbuffer).asARGB();
+			for (int by=y; by<std::min(y+stride, height); by++) {
+				for (int bx=x; bx<std::min(x+stride, width); bx++) {
+					window.setPixelColour(bx, by, colour);
 				}
-			} else if (camera->mode == "RAYTRACE_R") {
-				auto lighting = calculateRaytracedLighting(camera, toPaint.second, *light, triangles);
-				if (toPaint.first.colour == Colour(255, 0,255)) {
-					window.setPixelColour(WIDTH/2-i, HEIGHT/2-j, (getReflectionColour(camera, texture, toPaint.second, light, toPaint.first, triangles) *lighting).asARGB());
+			}
+		}
+	}
+	if (stride == 1) gbuffer->supersampledPixels = settings.antialias ? supersampleEdges(camera, texture, triangles, lights, settings, gbuffer, window) : 0;
+	progressive->advance();
+}
+
+// Draws a raytraced frame of a camera path, reusing the previous frame's shading wherever it reprojects onto the same
+// surface (see TemporalReprojection). Visibility for every pixel comes from the rasteriser, so only the pixels whose
+// surface is newly in view, or whose old shading can't be trusted, cast shadow and reflection rays.
+void drawReprojectedRaytraceOBJ(Camera *camera, const std::vector<std::vector<TexturePoint>>& texture, const std::vector<ModelTriangle>& triangles, const LightSet &lights, const RenderSettings &settings, TemporalReprojection *reprojection, GBuffer *gbuffer, DrawingWindow &window) {
+	gbuffer->useScene(triangles);
+	gbuffer->invalidate();
+	rasterisePrimaryVisibility(camera, triangles, gbuffer);
+	const int width = window.width, height = window.height;
+	reprojection->begin(width, height);
+	const bool reusable = reprojection->matches(*camera, lights);
+	auto difference = [](uint32_t a, uint32_t b) {
+		int sum = 0;
+		for (int shift = 0; shift <= 16; shift += 8) sum += std::abs(int((a >> shift) & 0xFF) - int((b >> shift) & 0xFF));
+		return sum / 3.0f;
+	};
+	int covered = 0, reused = 0, checked = 0;
+	float error = 0;
+#pragma omp parallel for reduction(+:covered, reused, checked, error)
+	for (int y=0; y<height; y++) {
+		for (int x=0; x<width; x++) {
+			uint32_t colour;
+			covered += gbuffer->at(x, y).hit;
+			if (reusable && reprojection->reuse(x, y, gbuffer->at(x, y), *camera, colour)) {
+				if ((y * width + x) % reprojection->checkInterval == 0) {
+					// the quality guard's sample: shaded anyway, to see how far the reused colours are off
+					uint32_t fresh = raytracePixel(camera, x, y, texture, triangles, lights, settings, gbuffer).asARGB();
+					error += difference(colour, fresh);
+					checked++;
+					colour = fresh;
+					reprojection->markShaded(x, y);
 				} else {
-					window.setPixelColour(WIDTH/2-i, HEIGHT/2-j, (toPaint.first.colour * lighting).asARGB());
+					reused++;
+				}
+			} else {
+				colour = raytracePixel(camera, x, y, texture, triangles, lights, settings, gbuffer).asARGB();
+			}
+			window.setPixelColour(x, y, colour);
+		}
+	}
+	reprojection->checkedError = checked > 0 ? error / checked : 0;
+	if (reprojection->checkedError > reprojection->errorLimit) {
+		// reuse has drifted too far from what shading gives, so the rest of the frame is shaded after all
+#pragma omp parallel for
+		for (int y=0; y<height; y++) {
+			for (int x=0; x<width; x++) {
+				if (!reprojection->wasReused(x, y)) continue;
+				window.setPixelColour(x, y, raytracePixel(camera, x, y, texture, triangles, lights, settings, gbuffer).asARGB());
+				reprojection->markShaded(x, y);
+			}
+		}
+		reused = 0;
+	}
+	for (int y=0; y<height; y++) {
+		for (int x=0; x<width; x++) {
+			reprojection->keep(x, y, window.getPixelColour(x, y));
+		}
+	}
+	reprojection->reused = reused;
+	// pixels that see nothing cost nothing either way, so they count as neither
+	reprojection->shaded = covered - reused;
+	reprojection->store(*camera, primaryRayBasis(camera, height), lights, *gbuffer);
+}
+
+// Direction about the normal with probability proportional to the cosine, which cancels the cosine in a diffuse bounce
+glm::vec3 cosineSampleHemisphere(const glm::vec3 normal, Random &random) {
+	float radius = std::sqrt(random.next());
+	float phi = 2 * 3.14159265f * random.next();
+	glm::vec3 tangent = normalize(cross(std::abs(normal.x) > 0.5f ? glm::vec3(0, 1, 0) : glm::vec3(1, 0, 0), normal));
+	glm::vec3 bitangent = cross(normal, tangent);
+	return normalize(radius * std::cos(phi) * tangent + radius * std::sin(phi) * bitangent + std::sqrt(std::max(0.0f, 1 - radius * radius)) * normal);
+}
+
+// One Monte-Carlo path from a primary hit, returning unclamped radiance. Every diffuse vertex gets next-event estimation
+// toward one light picked by LightSet::choose, then bounces in a cosine-weighted direction; mirrors reflect. The path
+// ends when it leaves the box, after settings.maxDepth bounces, or by Russian roulette past settings.rouletteDepth.
+glm::vec3 tracePath(Camera *camera, const GBufferSample &sample, const std::vector<ModelTriangle> &triangles, const LightSet &lights, const RenderSettings &settings, Random &random) {
+	const glm::mat3 flip = glm::mat3(glm::vec3(1,0,0), glm::vec3(0,1,0), glm::vec3(0,0,-1));
+	glm::vec3 radiance = {0, 0, 0};
+	glm::vec3 throughput = {1, 1, 1};
+	glm::vec3 position = sample.position;
+	glm::vec3 direction = normalize(position - camera->position);
+	const ModelTriangle *triangle = &triangles[sample.triangleIndex];
+	for (int depth = 0; ; depth++) {
+		glm::vec3 normal = dot(direction, triangle->normal) < 0 ? triangle->normal : -triangle->normal;
+		if (isMirror("PATHTRACE", *triangle)) {
+			direction = normalize(direction - 2 * normal * dot(direction, normal));
+			throughput *= 0.9f;
+		} else {
+			glm::vec3 albedo = glm::vec3(triangle->colour.red, triangle->colour.green, triangle->colour.blue) / 255.0f;
+			float probability;
+			size_t index = lights.choose(position, random.next(), probability);
+			if (index < lights.lights.size()) {
+				const Light &light = lights.lights[index];
+				glm::vec3 target = light.samplePoint(random.next(), random.next());
+				glm::vec3 toLight = target - position;
+				float distanceSquared = dot(toLight, toLight);
+				float cosine = dot(normal, toLight) / std::sqrt(distanceSquared);
+				if (cosine > 0 && !isOccluded(position + 0.001f * normal, target, triangles)) {
+					// the same clamped falloff as the other modes, which also keeps the point light from making fireflies
+					radiance += throughput * albedo * (light.intensity * std::min(1.0f, 1 / distanceSquared) * cosine / probability);
 				}
 			}
+			throughput *= albedo;
+			direction = cosineSampleHemisphere(normal, random);
+		}
+		if (depth + 1 >= settings.maxDepth) break;
+		if (depth >= settings.rouletteDepth) {
+			float survival = std::min(1.0f, std::max({throughput.x, throughput.y, throughput.z}));
+			if (random.next() >= survival) break;
+			throughput /= survival;
+		}
+		RayTriangleIntersection hit = findClosestIntersection(position + 0.001f * normal, flip * direction, triangles);
+		if (hit.triangleIndex >= triangles.size()) break;
+		position = hit.intersectionPoint;
+		triangle = &triangles[hit.triangleIndex];
+	}
+	return radiance;
+}
+
+// Adds one path per pixel to the accumulation buffer and shows the running average. Primary hits come from the G-buffer,
+// so passes after the first only pay for the bounces.
+void drawPathTraceOBJ(Camera *camera, const std::vector<ModelTriangle>& triangles, const LightSet &lights, const RenderSettings &settings, GBuffer *gbuffer, AccumulationBuffer *accumulation, DrawingWindow &window) {
+	gbuffer->useScene(triangles);
+	auto start = std::chrono::steady_clock::now();
+	const int pass = accumulation->samples;
+	const int width = window.width, height = window.height;
+#pragma omp parallel for
+	for (int y=0; y<height; y++) {
+		for (int x=0; x<width; x++) {
+			GBufferSample &sample = gbuffer->at(x, y);
+			if (!sample.valid) tracePrimaryRay(camera, x + 0.5f, y + 0.5f, width, height, triangles, sample);
+			glm::vec3 &sum = accumulation->at(x, y);
+			if (sample.hit) {
+				Random random = Random(Random::seedFor(x, y, pass));
+				sum += tracePath(camera, sample, triangles, lights, settings, random);
+			}
+			glm::vec3 colour = glm::min(sum / static_cast<float>(pass + 1), glm::vec3(1, 1, 1)) * 255.0f;
+			window.setPixelColour(x, y, Colour(colour.x, colour.y, colour.z).asARGB());
+		}
+	}
+	accumulation->samples++;
+	accumulation->seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Stretches a frame rendered below the window size over the whole window, blending the four nearest pixels
+void upscaleFrame(DrawingWindow &frame, DrawingWindow &window) {
+	const float scaleX = static_cast<float>(frame.width) / window.width, scaleY = static_cast<float>(frame.height) / window.height;
+#pragma omp parallel for
+	for (int y = 0; y < static_cast<int>(window.height); y++) {
+		float v = std::max(0.0f, (y + 0.5f) * scaleY - 0.5f);
+		size_t y0 = std::min(static_cast<size_t>(v), frame.height - 1), y1 = std::min(y0 + 1, frame.height - 1);
+		float fy = v - y0;
+		for (size_t x = 0; x < window.width; x++) {
+			float u = std::max(0.0f, (x + 0.5f) * scaleX - 0.5f);
+			size_t x0 = std::min(static_cast<size_t>(u), frame.width - 1), x1 = std::min(x0 + 1, frame.width - 1);
+			float fx = u - x0;
+			uint32_t corners[4] = {frame.getPixelColour(x0, y0), frame.getPixelColour(x1, y0), frame.getPixelColour(x0, y1), frame.getPixelColour(x1, y1)};
+			uint32_t colour = 0xFF000000;
+			for (int shift = 0; shift <= 16; shift += 8) {
+				float top = (1 - fx) * ((corners[0] >> shift) & 0xFF) + fx * ((corners[1] >> shift) & 0xFF);
+				float bottom = (1 - fx) * ((corners[2] >> shift) & 0xFF) + fx * ((corners[3] >> shift) & 0xFF);
+				colour |= static_cast<uint32_t>(std::round((1 - fy) * top + fy * bottom)) << shift;
+			}
+			window.setPixelColour(x, y, colour);
 		}
 	}
 }
 
 // Set the depth buffer to very far away everywhere
 void clearDepthBuffer(std::vector<std::vector<float>> *depthBuffer) {
-	std::vector<float> smol;
-	for (int x=0; x<WIDTH; x++) {
-		smol.push_back(-100);
-	}
-	for (int y = 0; y < HEIGHT; ++y) {
-		(*depthBuffer)[y] = smol;
+	for (auto &row : *depthBuffer) {
+		std::fill(row.begin(), row.end(), -100);
 	}
 }
 
 // Defines keyboard input behaviour
-void handleEvent(const SDL_Event &event, std::vector<std::vector<float>> *depthBuffer, Camera *camera, std::string filename, Light *light, DrawingWindow &window) {
+void handleEvent(const SDL_Event &event, std::vector<std::vector<float>> *depthBuffer, Camera *camera, std::string filename, LightSet *lights, RenderSettings *settings, ProgressiveRefinement *progressive, DrawingWindow &window) {
 	if (event.type == SDL_KEYDOWN) {
 		if (event.key.keysym.sym == SDLK_u) {
-			CanvasTriangle triangle = randomTriangle();
+			CanvasTriangle triangle = randomTriangle(window);
 			drawStrokedTriangle(triangle, Colour(rand()%255,rand()%255, rand()%255), window);
 		}
 		else if (event.key.keysym.sym == SDLK_y) {
-			CanvasTriangle triangle = randomTriangle();
+			CanvasTriangle triangle = randomTriangle(window);
 			drawOccludedFilledTriangle(triangle, Colour(rand()%255,rand()%255, rand()%255), true, depthBuffer, window);
 		}
 		// else if (event.key.keysym.sym == SDLK_t) {
@@ -1007,8 +1602,6 @@ void handleEvent(const SDL_Event &event, std::vector<std::vector<float>> *depthB
 		// }
 		else if (event.key.keysym.sym == SDLK_e) {
 			camera->lookAt(glm::vec3(0,0,0));
-			window.clearPixels();
-			clearDepthBuffer(depthBuffer);
 		}
 		else if (event.key.keysym.sym == SDLK_o) {
 			// Print current orientation matrix
@@ -1017,45 +1610,100 @@ void handleEvent(const SDL_Event &event, std::vector<std::vector<float>> *depthB
 			std::cout << camera->orientation[0][2] << ", " << camera->orientation[1][2] << ", " << camera->orientation[2][2] << std::endl;
 		}
 		else if (event.key.keysym.sym == SDLK_1) {
-			camera->mode = "WIREFRAME";
+			camera->changeMode("WIREFRAME");
 		}
 		else if (event.key.keysym.sym == SDLK_2) {
-			camera->mode = "RASTERISE";
+			camera->changeMode("RASTERISE");
 		}
 		else if (event.key.keysym.sym == SDLK_3) {
 			//proximity lighting
-			camera->mode = "RAYTRACE_P";
+			camera->changeMode("RAYTRACE_P");
 		}
 		else if (event.key.keysym.sym == SDLK_4) {
 			//prox, diff and specular
-			camera->mode = "RAYTRACE_D";
+			camera->changeMode("RAYTRACE_D");
 		}
 		else if (event.key.keysym.sym == SDLK_5) {
 			//sphere wireframe
-			camera->mode = "SPHERE_W";
+			camera->changeMode("SPHERE_W");
 		}
 		else if (event.key.keysym.sym == SDLK_6) {
 			//enable Gouraud shading
-			camera->mode = "SPHERE_G";
+			camera->changeMode("SPHERE_G");
 		}
 		else if (event.key.keysym.sym == SDLK_7) {
 			//enable Phong shading
-			camera->mode = "SPHERE_P";
+			camera->changeMode("SPHERE_P");
 		}
 		else if (event.key.keysym.sym == SDLK_8) {
 			//texture map
 			std::cout << "boople" << std::endl;
-			camera->mode = "RAYTRACE_TM";
+			camera->changeMode("RAYTRACE_TM");
 		}
 		else if (event.key.keysym.sym == SDLK_9) {
 			//texture map
 			std::cout << "boople" << std::endl;
-			camera->mode = "RAYTRACE_R";
+			camera->changeMode("RAYTRACE_R");
+		}
+		else if (event.key.keysym.sym == SDLK_0) {
+			//mirror and glass
+			camera->changeMode("RAYTRACE_G");
+		}
+		else if (event.key.keysym.sym == SDLK_b) {
+			settings->antialias = !settings->antialias;
+			std::cout << "adaptive anti-aliasing " << (settings->antialias ? "on" : "off") << std::endl;
+		}
+		else if (event.key.keysym.sym == SDLK_LEFTBRACKET) {
+			settings->maxDepth = std::max(1, settings->maxDepth - 1);
+			std::cout << "max bounces " << settings->maxDepth << std::endl;
+		}
+		else if (event.key.keysym.sym == SDLK_RIGHTBRACKET) {
+			settings->maxDepth = std::min(16, settings->maxDepth + 1);
+			std::cout << "max bounces " << settings->maxDepth << std::endl;
+		}
+		else if (event.key.keysym.sym == SDLK_COMMA) {
+			auto &samples = settings->shadowSamples[camera->mode];
+			samples = std::max(1, samples / 2);
+			std::cout << camera->mode << " shadow samples " << samples << std::endl;
+		}
+		else if (event.key.keysym.sym == SDLK_PERIOD) {
+			auto &samples = settings->shadowSamples[camera->mode];
+			samples = std::min(256, std::max(1, samples * 2));
+			std::cout << camera->mode << " shadow samples " << samples << std::endl;
+		}
+		else if (event.key.keysym.sym == SDLK_l) {
+			// point -> quad -> sphere light
+			lights->current().nextShape();
+		}
+		else if (event.key.keysym.sym == SDLK_k) {
+			// a dimmer, short range lamp where the camera is
+			Light lamp = Light(camera->position, 0.5);
+			lamp.range = 2;
+			lights->add(lamp);
+			std::cout << "added light " << lights->selected << std::endl;
+		}
+		else if (event.key.keysym.sym == SDLK_j) {
+			lights->selectNext();
+			std::cout << "moving light " << lights->selected << std::endl;
+		}
+		else if (event.key.keysym.sym == SDLK_i) {
+			//progressive path tracing
+			camera->changeMode("PATHTRACE");
+		}
+		else if (event.key.keysym.sym == SDLK_h) {
+			//rasterised visibility, raytraced shadows and reflections
+			camera->changeMode("HYBRID");
 		}
 		else if (event.key.keysym.sym == SDLK_r) {
 			//texture map
 			std::cout << "boople" << std::endl;
-			camera->mode = "RECORD";
+			camera->changeMode("RECORD");
+		}
+		else if (event.key.keysym.sym == SDLK_g) {
+			// toggle progressive refinement for the raytraced modes
+			progressive->enabled = !progressive->enabled;
+			progressive->restart();
+			std::cout << "progressive refinement " << (progressive->enabled ? "on" : "off") << std::endl;
 		}
 		else if (event.key.keysym.sym == SDLK_p) {
 			auto print = camera->position;
@@ -1067,248 +1715,1153 @@ void handleEvent(const SDL_Event &event, std::vector<std::vector<float>> *depthB
 	}
 }
 
-void draw(std::vector<std::vector<float>> *depthBuffer, Camera *camera, std::vector<ModelTriangle> trianglesB, std::vector<ModelTriangle> trianglesS, const std::vector<std::vector<TexturePoint>>& texture, Light *light, DrawingWindow &window) {
+void draw(std::vector<std::vector<float>> *depthBuffer, Camera *camera, const Scene &scene, const LightSet &lights, const RenderSettings &settings, ProgressiveRefinement *progressive, GBuffer *gbuffer, AccumulationBuffer *accumulation, DrawingWindow &window) {
+	const auto &trianglesB = scene.box;
+	const auto &trianglesS = scene.sphere;
+	const auto &texture = scene.texture;
+	// nothing from the previous frame's scratch buffers is still alive
+	FrameArena::resetAll();
+	if (camera->mode == "HYBRID") {
+		// primary visibility comes from the rasteriser, so the raytracer only casts shadow and reflection rays
+		gbuffer->useScene(trianglesB);
+		if (!gbuffer->complete) rasterisePrimaryVisibility(camera, trianglesB, gbuffer);
+	}
+	if (camera->mode == "PATHTRACE") {
+		// accumulates on top of whatever was drawn before, and refines itself, so it never takes the progressive path
+		drawPathTraceOBJ(camera, trianglesB, lights, settings, gbuffer, accumulation, window);
+		return;
+	}
+	if (progressive != nullptr && progressive->enabled && camera->raytraced()) {
+		progressive->update(*camera, lights);
+		drawProgressiveRaytraceOBJ(camera, texture, scene.trianglesFor(camera->mode), lights, settings, progressive, gbuffer, window);
+		return;
+	}
 	window.clearPixels();
 	if (camera->mode == "WIREFRAME") {
 		for (int i=0; i<trianglesB.size(); i++) {
-			auto triangle = trianglesB[i];
+			const auto &triangle = trianglesB[i];
 			clearDepthBuffer(depthBuffer);
 			CanvasTriangle zoop = CanvasTriangle(
-			projectVertexOntoCanvasPoint(camera, triangle.vertices[0], 160),
-			projectVertexOntoCanvasPoint(camera, triangle.vertices[1], 160),
-			projectVertexOntoCanvasPoint(camera, triangle.vertices[2], 160));
+			projectVertexOntoCanvasPoint(camera, triangle.vertices[0], window),
+			projectVertexOntoCanvasPoint(camera, triangle.vertices[1], window),
+			projectVertexOntoCanvasPoint(camera, triangle.vertices[2], window));
 			drawStrokedTriangle(zoop, triangle.colour, window);
 		}
 	} else if (camera->mode == "RASTERISE") {
 		clearDepthBuffer(depthBuffer);
-		drawOBJ(camera, 160, depthBuffer, trianglesB, window);
+		drawOBJ(camera, depthBuffer, trianglesB, window);
 	} else if (camera->mode == "RAYTRACE_TM") {
-		drawRaytraceOBJ(camera, 0.35, texture, trianglesB, light, window);
+		drawRaytraceOBJ(camera, texture, trianglesB, lights, settings, gbuffer, window);
 	} else if (camera->mode == "RAYTRACE_R") {
-		drawRaytraceOBJ(camera, 0.35, texture, trianglesB, light, window);
+		drawRaytraceOBJ(camera, texture, trianglesB, lights, settings, gbuffer, window);
 	} else if (camera->mode == "SPHERE_G" || camera->mode == "SPHERE_P") {
-		drawRaytraceOBJ(camera, 0.35, texture, trianglesS, light, window);
+		drawRaytraceOBJ(camera, texture, trianglesS, lights, settings, gbuffer, window);
 	} else if (camera->mode == "SPHERE_W") {
 		for (int i=0; i<trianglesS.size(); i++) {
-			auto triangle = trianglesS[i];
+			const auto &triangle = trianglesS[i];
 			clearDepthBuffer(depthBuffer);
 			CanvasTriangle zoop = CanvasTriangle(
-			projectVertexOntoCanvasPoint(camera, triangle.vertices[0], 160),
-			projectVertexOntoCanvasPoint(camera, triangle.vertices[1], 160),
-			projectVertexOntoCanvasPoint(camera, triangle.vertices[2], 160));
+			projectVertexOntoCanvasPoint(camera, triangle.vertices[0], window),
+			projectVertexOntoCanvasPoint(camera, triangle.vertices[1], window),
+			projectVertexOntoCanvasPoint(camera, triangle.vertices[2], window));
 			drawStrokedTriangle(zoop, triangle.colour, window);
 		}
 	} else if (camera->mode == "RECORD") {
 		for (int i=0; i<trianglesB.size(); i++) {
-			auto triangle = trianglesB[i];
+			const auto &triangle = trianglesB[i];
 			clearDepthBuffer(depthBuffer);
 			CanvasTriangle zoop = CanvasTriangle(
-			projectVertexOntoCanvasPoint(camera, triangle.vertices[0], 160),
-			projectVertexOntoCanvasPoint(camera, triangle.vertices[1], 160),
-			projectVertexOntoCanvasPoint(camera, triangle.vertices[2], 160));
+			projectVertexOntoCanvasPoint(camera, triangle.vertices[0], window),
+			projectVertexOntoCanvasPoint(camera, triangle.vertices[1], window),
+			projectVertexOntoCanvasPoint(camera, triangle.vertices[2], window));
 			drawStrokedTriangle(zoop, triangle.colour, window);
 		}
 	} else {
-		drawRaytraceOBJ(camera, 0.35, texture, trianglesB, light, window);
+		drawRaytraceOBJ(camera, texture, trianglesB, lights, settings, gbuffer, window);
 	}
 }
 
-void movement(std::vector<std::vector<float>> *depthBuffer, Camera *camera, DrawingWindow &window, Light *light, const float deltaTime) {
+// Moves the camera and the selected light for the keys held down. Runs on the input thread, so it leaves the window alone:
+// the render thread redraws from the new pose anyway.
+void movement(Camera *camera, LightSet *lights, const float deltaTime) {
 	const Uint8 *state = SDL_GetKeyboardState(NULL);
 	float speed = 0.5f;
 	if (state[SDL_SCANCODE_LEFT]) {
 		camera->translateCamera(glm::vec3(1, 0, 0) * speed * deltaTime);
-		window.clearPixels();
-		clearDepthBuffer(depthBuffer);
 	}
 	if (state[SDL_SCANCODE_RIGHT]) {
 		camera->translateCamera(glm::vec3(-1, 0, 0) * speed * deltaTime);
-		window.clearPixels();
-		clearDepthBuffer(depthBuffer);
 	}
 	if (state[SDL_SCANCODE_UP]) {
 		camera->translateCamera(glm::vec3(0, -1, 0) * speed * deltaTime);
-		window.clearPixels();
-		clearDepthBuffer(depthBuffer);
 	}
 	if (state[SDL_SCANCODE_DOWN]) {
 		camera->translateCamera(glm::vec3(0, 1, 0) * speed * deltaTime);
-		window.clearPixels();
-		clearDepthBuffer(depthBuffer);
 	}
 	if (state[SDL_SCANCODE_W]) {
 		camera->tiltCamera(speed * deltaTime);
-		window.clearPixels();
-		clearDepthBuffer(depthBuffer);
 	}
 	if (state[SDL_SCANCODE_S]) {
 		camera->tiltCamera(-speed * deltaTime);
-		window.clearPixels();
-		clearDepthBuffer(depthBuffer);
 	}
 	if (state[SDL_SCANCODE_A]) {
 		camera->panCamera(-speed * deltaTime);
-		window.clearPixels();
-		clearDepthBuffer(depthBuffer);
 	}
 	if (state[SDL_SCANCODE_D]) {
 		camera->panCamera(speed * deltaTime);
-		window.clearPixels();
-		clearDepthBuffer(depthBuffer);
 	}
 	if (state[SDL_SCANCODE_Z]) {
 		camera->translateCamera(glm::vec3(0, 0, 1) * speed * deltaTime);
-		window.clearPixels();
-		clearDepthBuffer(depthBuffer);
 	}
 	if (state[SDL_SCANCODE_X]) {
 		camera->translateCamera(glm::vec3(0, 0, -1) * speed * deltaTime);
-		window.clearPixels();
-		clearDepthBuffer(depthBuffer);
 	}
 	if (state[SDL_SCANCODE_Q]) {
 		camera->orbit(0.3f * deltaTime);
 		camera->lookAt(glm::vec3(0,0,0));
-		window.clearPixels();
-		clearDepthBuffer(depthBuffer);
 	}
 	if (state[SDL_SCANCODE_MINUS]) {
-		light->position -= (0.1f * deltaTime * glm::vec3{0,1,-0.1});
+		lights->current().move(-(0.1f * deltaTime * glm::vec3{0,1,-0.1}));
 	}
 	if (state[SDL_SCANCODE_EQUALS]) {
-		light->position += (0.1f * deltaTime * glm::vec3{0,1,-0.1});
+		lights->current().move(0.1f * deltaTime * glm::vec3{0,1,-0.1});
 	}
 }
 
-void doPlayback(Camera *camera, std::vector<std::pair<glm::vec3, glm::mat3>> poss, std::vector<std::vector<float>> *depthBuffer,std::vector<ModelTriangle> trianglesB,std::vector<ModelTriangle> trianglesS, const std::vector<std::vector<TexturePoint>>& texture, Light *light, DrawingWindow window){
-	int id=0;
-	camera->mode = "SPHERE_P";
-	std::string filename;
-	for (auto elem : poss) {
-		camera->position = elem.first;
-		camera->orientation = elem.second;
-		draw(depthBuffer, camera, trianglesB, trianglesS, texture, light, window);
-		if (id < 10){
-			filename = "assets/bmps/b000" + std::to_string(id) + ".bmp";
-		}else if (id < 100){
-			filename = "assets/bmps/b00" + std::to_string(id) + ".bmp";
-		}else if (id < 1000){
-			filename = "assets/bmps/b0" + std::to_string(id) + ".bmp";
-		}else{
-			filename = "assets/bmps/b" + std::to_string(id) + ".bmp";
+// How doPlayback renders a camera path, and where the frames go
+struct PlaybackOptions {
+	float framesPerSecond = 30;
+	TemporalReprojection reprojection;
+	int firstFrame = 0;                 // render frames [firstFrame, lastFrame), a negative lastFrame meaning to the end
+	int lastFrame = -1;
+	VideoWriter *video = nullptr;       // frames are encoded into this when it's open
+	bool keepFrames = true;             // ... and saved to assets/bmps as well if this is set
+	std::FILE *frameStream = nullptr;   // a worker sends its frames back to the coordinator on this instead
+};
+
+// How many frames a camera path makes at framesPerSecond, counting one at each end
+int playbackFrames(const CameraPath &path, float framesPerSecond) {
+	return static_cast<int>(std::floor(path.duration() * framesPerSecond)) + 1;
+}
+
+// Hands a finished playback frame on to wherever frames are going and returns what to call it in the log
+std::string outputFrame(int frame, DrawingWindow &window, const PlaybackOptions &options) {
+	if (options.frameStream != nullptr) {
+		std::vector<uint32_t> pixels(window.width * window.height);
+		for (size_t y = 0; y < window.height; y++) {
+			for (size_t x = 0; x < window.width; x++) {
+				pixels[y * window.width + x] = window.getPixelColour(x, y);
+			}
 		}
-		window.saveBMP(filename);
-		std::cout << "frame " << filename << std::endl;
-		id++;
+		if (!writeStreamFrame(options.frameStream, frame, window.width, window.height, pixels)) printMessageAndQuit("Could not send frame " + std::to_string(frame) + " to the coordinator", "");
+		return std::to_string(frame);
+	}
+	if (options.video != nullptr && options.video->isOpen() && !options.video->writeFrame(window)) printMessageAndQuit("Could not write frame " + std::to_string(frame) + " to the video", "");
+	if (!options.keepFrames) return std::to_string(frame);
+	char filename[32];
+	std::snprintf(filename, sizeof(filename), "assets/bmps/b%04d.bmp", frame);
+	window.saveBMP(filename);
+	return filename;
+}
+
+// Renders a recorded camera path at options.framesPerSecond, interpolating between the recorded poses, in the mode and
+// with the light position it was recorded with where the recording has them (the sphere in Phong otherwise).
+// With reprojection enabled the raytraced modes carry shading over from frame to frame and report how much they reused.
+void doPlayback(Camera *camera, const CameraPath &path, bool hasLight, PlaybackOptions options, std::vector<std::vector<float>> *depthBuffer, const Scene &scene, LightSet lights, DrawingWindow &window){
+	camera->changeMode("SPHERE_P");
+	GBuffer gbuffer = GBuffer(window.width, window.height);
+	AccumulationBuffer accumulation = AccumulationBuffer(window.width, window.height);
+	const RenderSettings settings = RenderSettings();
+	TemporalReprojection &reprojection = options.reprojection;
+	const int frames = playbackFrames(path, options.framesPerSecond);
+	const int last = options.lastFrame < 0 ? frames : std::min(options.lastFrame, frames);
+	for (int frame = options.firstFrame; frame < last; frame++) {
+		const float time = frame / options.framesPerSecond;
+		camera->setPose(path.position(time), path.orientation(time));
+		if (!path.mode(time).empty()) camera->changeMode(path.mode(time));
+		// moved rather than set, so the light's revision tells reprojection the shading is stale
+		if (hasLight && path.light(time) != lights.current().position) lights.current().move(path.light(time) - lights.current().position);
+		const bool reprojecting = reprojection.enabled && camera->raytraced() && camera->mode != "PATHTRACE";
+		if (reprojecting) {
+			FrameArena::resetAll();
+			drawReprojectedRaytraceOBJ(camera, scene.texture, scene.trianglesFor(camera->mode), lights, settings, &reprojection, &gbuffer, window);
+		} else {
+			reprojection.reset();
+			gbuffer.invalidate();
+			accumulation.reset();
+			draw(depthBuffer, camera, scene, lights, settings, nullptr, &gbuffer, &accumulation, window);
+		}
+		std::cout << "frame " << outputFrame(frame, window, options);
+		if (reprojecting) {
+			std::cout << std::fixed << std::setprecision(1) << "  reused " << reprojection.reuseRate() * 100 << "%  shaded " << reprojection.shaded << " px  check error " << std::setprecision(2) << reprojection.checkedError;
+			if (reprojection.checkedError > reprojection.errorLimit) std::cout << " (over the limit, shaded in full)";
+		}
+		std::cout << std::endl;
 	}
 }
 
-std::vector<std::pair<glm::vec3, glm::mat3>> parseRecording(std::string filename){
-	std::ifstream myfile;
-	myfile.open("/home/dustmodebros/CG2024/Weekly Workbooks/01 Introduction and Orientation/extras/RedNoise/assets/recording.txt",std::ios_base::in);
-	std::string line;
-	std::vector<std::pair<glm::vec3, glm::mat3>> out;
-	while(std::getline(myfile, line)){
-		std::string posLine;
-		std::string orLine1;
-		std::string orLine2;
-		std::string orLine3;
-		getline(myfile, posLine);
-		getline(myfile, orLine1);
-		getline(myfile, orLine2);
-		getline(myfile, orLine3);
-		posLine = posLine.substr(posLine.find(":")+2);
-		float posLine1 = std::stof(posLine.substr(0,posLine.find(",")));
-		posLine = posLine.substr(posLine.find(",")+2);
-		float posLine2 = std::stof(posLine.substr(0,posLine.find(",")));
-		posLine = posLine.substr(posLine.find(",")+2);
-		float posLine3 = std::stof(posLine);
-		glm::vec3 pos = {posLine1, posLine2, posLine3};
-
-		orLine1 = orLine1.substr(orLine1.find(":")+1);
-		float orLine11 = std::stof(orLine1.substr(0,orLine1.find(",")));
-		orLine1 = orLine1.substr(orLine1.find(",")+1);
-		float orLine12 = std::stof(orLine1.substr(0,orLine1.find(",")));
-		orLine1 = orLine1.substr(orLine1.find(",")+1);
-		float orLine13 = std::stof(orLine1);
-
-		orLine2 = orLine2.substr(orLine2.find(":")+1);
-		float orLine21 = std::stof(orLine2.substr(0,orLine2.find(",")));
-		orLine2 = orLine2.substr(orLine2.find(",")+1);
-		float orLine22 = std::stof(orLine2.substr(0,orLine2.find(",")));
-		orLine2 = orLine2.substr(orLine2.find(",")+1);
-		float orLine23 = std::stof(orLine2);
-
-		orLine3 = orLine3.substr(orLine3.find(":")+1);
-		float orLine31 = std::stof(orLine3.substr(0,orLine3.find(",")));
-		orLine3 = orLine3.substr(orLine3.find(",")+1);
-		float orLine32 = std::stof(orLine3.substr(0,orLine3.find(",")));
-		orLine3 = orLine3.substr(orLine3.find(",")+1);
-		float orLine33 = std::stof(orLine3);
-
-		glm::vec3 or1 = {orLine11, orLine21, orLine31};
-		glm::vec3 or2 = {orLine12, orLine22, orLine32};
-		glm::vec3 or3 = {orLine13, orLine23, orLine33};
-		auto orMat = glm::mat3(or1, or2, or3);
-		out.emplace_back(std::pair<glm::vec3, glm::mat3>(pos, orMat));
-	}
-	return out;
+// Renders a width x height playback by sending ranges of its frames to worker processes (see FrameCoordinator), each
+// one running workerCommand, and outputs the frames in order as they come back
+int coordinatePlayback(const CameraPath &path, const std::string &workerCommand, int workers, int chunkFrames, int workerTimeout, int width, int height, const PlaybackOptions &options) {
+	const int frames = playbackFrames(path, options.framesPerSecond);
+	FrameCoordinator coordinator(workerCommand, frames, workers, chunkFrames);
+	coordinator.frameTimeout = workerTimeout;
+	DrawingWindow frame = DrawingWindow(width, height);
+	const auto start = std::chrono::steady_clock::now();
+	bool complete = coordinator.run([&](int index, size_t frameWidth, size_t frameHeight, const std::vector<uint32_t> &pixels) {
+		if (frameWidth != frame.width || frameHeight != frame.height) printMessageAndQuit("Frame " + std::to_string(index) + " came back at the wrong size", "");
+		for (size_t y = 0; y < frame.height; y++) {
+			for (size_t x = 0; x < frame.width; x++) {
+				frame.setPixelColour(x, y, pixels[y * frame.width + x]);
+			}
+		}
+		std::cout << "frame " << outputFrame(index, frame, options) << std::endl;
+	});
+	if (!complete) {
+		std::cout << "playback failed, the workers could not render every frame" << std::endl;
+		return 1;
+	}
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	std::cout << frames << " frames from " << workers << " workers in " << std::fixed << std::setprecision(1) << seconds << " s" << std::endl;
+	return 0;
+}
+
+// Return a pointer to a new Scene with the box, the sphere and the texture, for the offscreen entry points
+Scene *loadScene() {
+	const auto texture_map = TextureMap("assets/texture.ppm");
+	auto texture = loadTexture(texture_map);
+	Light light = Light();
+	auto trianglesB = debugParseOBJ("assets/cornell-box.obj", light, texture, 0.35);
+	auto trianglesS = debugParseOBJ("assets/sphere.obj", light, texture, 0.35);
+	return new Scene(std::move(trianglesB), std::move(trianglesS), std::move(texture));
+}
+
+// Reads the camera path out of a recording file, quitting if it can't, and says whether it moves the light too
+CameraPath loadCameraPath(const std::string &filename, bool &hasLight) {
+	RecordingReader recording;
+	if (!recording.open(filename)) printMessageAndQuit("Could not open recording " + filename, "");
+	hasLight = recording.header.flags & RECORDING_HAS_LIGHT;
+	return CameraPath(recording);
+}
+
+// Reads a size written as WIDTHxHEIGHT, e.g. 3840x2160, refusing anything after it like parseInteger does
+bool parseResolution(const std::string &text, int &width, int &height) {
+	char rest;
+	return std::sscanf(text.c_str(), "%dx%d%c", &width, &height, &rest) == 2 && width > 0 && height > 0;
+}
+
+// Reads a range of frames written as FIRST:LAST, e.g. 0:120, meaning FIRST up to but not including LAST
+bool parseFrameRange(const std::string &text, int &first, int &last) {
+	char rest;
+	return std::sscanf(text.c_str(), "%d:%d%c", &first, &last, &rest) == 2 && first >= 0 && first < last;
+}
+
+// Reads a whole number from the command line, or says what was expected there and returns false. Anything after the
+// number is refused, so a typo like 4x isn't quietly taken as 4.
+bool parseInteger(const std::string &text, const std::string &what, int &value) {
+	char rest;
+	if (std::sscanf(text.c_str(), "%d%c", &value, &rest) == 1) return true;
+	std::cout << "expected a whole number for " << what << ", got " << text << std::endl;
+	return false;
+}
+
+// Reads a number, fractions allowed, from the command line the same way
+bool parseNumber(const std::string &text, const std::string &what, double &value) {
+	char rest;
+	if (std::sscanf(text.c_str(), "%lf%c", &value, &rest) == 1) return true;
+	std::cout << "expected a number for " << what << ", got " << text << std::endl;
+	return false;
+}
+
+// The view every render starts from, looking into the box from in front of it
+Camera startingCamera() {
+	return Camera(glm::vec3(0,0,4), glm::mat3(glm::vec3(1,0,0),glm::vec3(0,1,0),glm::vec3(0,0,1)), 2);
+}
+
+// Shared setup for the offscreen renderers: an offscreen window of the size asked for and a camera at the starting
+// view. Says what was expected and returns false if the size can't be read.
+bool setUpOffscreen(const std::string &resolution, Camera &camera, DrawingWindow &window) {
+	int width, height;
+	if (!parseResolution(resolution, width, height)) {
+		std::cout << "expected a size like 3840x2160, got " << resolution << std::endl;
+		return false;
+	}
+	camera = startingCamera();
+	window = DrawingWindow(width, height);
+	return true;
+}
+
+// Lays out the instancing test scene: the cornell box once, and count copies of the sphere in a lattice inside it,
+// each one turned and sized a little differently
+void layOutInstances(const Scene &scene, int count, InstancedScene &instanced) {
+	const int box = instanced.addMesh(scene.box);
+	const int sphere = instanced.addMesh(scene.sphere);
+	instanced.addInstance(box, glm::mat4(1));
+	const BoundingBox room = instanced.meshes[box].bvh.nodes[0].bounds, ball = instanced.meshes[sphere].bvh.nodes[0].bounds;
+	const int side = std::max(1, static_cast<int>(std::ceil(std::cbrt(static_cast<float>(count)))));
+	// keep clear of the walls and of the light under the ceiling
+	const glm::vec3 lower = room.lower + 0.15f * (room.upper - room.lower), upper = room.upper - glm::vec3(0.15f, 0.35f, 0.15f) * (room.upper - room.lower);
+	const glm::vec3 cell = (upper - lower) / static_cast<float>(side);
+	const glm::vec3 ballSize = ball.upper - ball.lower;
+	const float fit = 0.8f * std::min(std::min(cell.x, cell.y), cell.z) / std::max(std::max(ballSize.x, ballSize.y), ballSize.z);
+	for (int index = 0; index < count; index++) {
+		Random random = Random(Random::seedFor(index, 0, 0));
+		glm::vec3 centre = lower + cell * (glm::vec3(index % side, index / side % side, index / (side * side)) + 0.5f);
+		float scale = fit * (0.6f + 0.4f * random.next());
+		glm::mat4 place = glm::translate(glm::mat4(1), centre) * glm::rotate(glm::mat4(1), 6.2831853f * random.next(), glm::vec3(0, 1, 0));
+		instanced.addInstance(sphere, glm::scale(place, glm::vec3(scale)) * glm::translate(glm::mat4(1), -ball.centre()));
+	}
+	instanced.buildTopLevel();
+}
+
+// Diffuse shading for an instanced scene hit: the triangle's colour lit by every light, with shadow rays through the instances
+Colour shadeInstanceHit(const InstancedScene &instanced, const InstanceHit &hit, const glm::vec3 &direction, const LightSet &lights) {
+	const Instance &instance = instanced.instances[hit.instance];
+	const Colour &colour = instanced.meshes[instance.mesh].triangles[hit.triangle].colour;
+	glm::vec3 normal = dot(hit.normal, direction) > 0 ? -hit.normal : hit.normal;
+	glm::vec3 origin = hit.point + 0.001f * normal;
+	float lit = 0;
+	for (const auto &light : lights.lights) {
+		glm::vec3 toLight = light.position - hit.point;
+		float distanceSquared = dot(toLight, toLight);
+		float fade = light.fade(hit.point);
+		if (fade <= 0 || instanced.occluded(origin, light.position)) continue;
+		lit += std::min(1.0f, light.intensity / distanceSquared) * std::max(0.0f, dot(normalize(toLight), normal)) * fade;
+	}
+	float brightness = 0.2f + 0.8f * std::min(1.0f, lit);
+	return {static_cast<int>(colour.red * brightness), static_cast<int>(colour.green * brightness), static_cast<int>(colour.blue * brightness)};
+}
+
+// Raytraces an InstancedScene into the window from the camera
+void drawInstancedScene(Camera *camera, const InstancedScene &instanced, const LightSet &lights, DrawingWindow &window) {
+	const glm::mat3 basis = primaryRayBasis(camera, window.height);
+	const int width = window.width, height = window.height;
+#pragma omp parallel for
+	for (int y = 0; y < height; y++) {
+		for (int x = 0; x < width; x++) {
+			glm::vec3 direction = normalize(basis * glm::vec3(width / 2.0f - (x + 0.5f), height / 2.0f - (y + 0.5f), 1));
+			InstanceHit hit = InstanceHit();
+			Colour colour = instanced.intersect(camera->position, direction, hit) ? shadeInstanceHit(instanced, hit, direction, lights) : Colour(0, 0, 0);
+			window.setPixelColour(x, y, colour.asARGB());
+		}
+	}
+}
+
+// The instanced scene's triangles carried out into world space, as one mesh
+std::vector<ModelTriangle> flattenInstances(const InstancedScene &instanced) {
+	std::vector<ModelTriangle> flattened;
+	flattened.reserve(instanced.instancedTriangles());
+	for (const auto &instance : instanced.instances) {
+		for (ModelTriangle triangle : instanced.meshes[instance.mesh].triangles) {
+			for (auto &vertex : triangle.vertices) vertex = glm::vec3(instance.toWorld * glm::vec4(vertex, 1));
+			triangle.normal = normalize(instance.normalToWorld * triangle.normal);
+			flattened.push_back(triangle);
+		}
+	}
+	return flattened;
+}
+
+// Checks the instanced scene's BVH walks against testing every triangle of every instance, over primary rays through
+// every eighth pixel, random rays from inside the box and random shadow segments. Returns how many disagreed out of tested.
+int checkInstancedRays(Camera *camera, const InstancedScene &instanced, const LightSet &lights, int width, int height, int &tested) {
+	const glm::mat3 basis = primaryRayBasis(camera, height);
+	const BoundingBox &world = instanced.topLevel.nodes[0].bounds;
+	int mismatches = 0;
+	tested = 0;
+	auto checkRay = [&](const glm::vec3 &origin, const glm::vec3 &direction) {
+		InstanceHit walked = InstanceHit(), every = InstanceHit();
+		const bool hit = instanced.intersect(origin, direction, walked);
+		if (hit != instanced.intersectEveryTriangle(origin, direction, every) || (hit && walked.distance != every.distance)) mismatches++;
+		tested++;
+	};
+	for (int y = 0; y < height; y += 8) {
+		for (int x = 0; x < width; x += 8) {
+			checkRay(camera->position, normalize(basis * glm::vec3(width / 2.0f - (x + 0.5f), height / 2.0f - (y + 0.5f), 1)));
+		}
+	}
+	Random random = Random(Random::seedFor(0, 0, 0));
+	auto inside = [&]() {
+		return world.lower + glm::vec3(random.next(), random.next(), random.next()) * (world.upper - world.lower);
+	};
+	for (int ray = 0; ray < 1024; ray++) {
+		const glm::vec3 origin = inside();
+		checkRay(origin, normalize(inside() - origin));
+		const glm::vec3 from = inside(), to = ray % 2 == 0 ? lights.lights[0].position : inside();
+		if (instanced.occluded(from, to) != instanced.occludedByAnyTriangle(from, to)) mismatches++;
+		tested++;
+	}
+	return mismatches;
+}
+
+// Renders one reference frame per mode offscreen and checks it against assets/golden/<mode>.ppm
+// Run from the build directory: ./Schungus --golden [MODE...] (or --golden-update to re-record the references)
+// MODE:QUAD and MODE:SPHERE render the mode lit by that area light instead of the point light, and MODE:LIGHTS adds two
+// short range lamps. MODE:AA turns on adaptive anti-aliasing and reports how much of the frame it supersampled.
+// MODE:REPROJECT renders the last frame of a short turn around the box with temporal reprojection, and checks that
+// starting the reprojection history partway through the turn, as a playback worker's range does, stays within
+// reprojection's own error of the reference. INSTANCES renders the --instances scene with 125 spheres, then checks the
+// BVH walks of every builder against testing every triangle (see checkInstancedRays), both through the two levels and
+// over the scene flattened into one mesh, which is big enough to take the builders' parallel paths
+int runGoldenHarness(const bool update, std::vector<std::string> modes) {
+	if (modes.empty()) modes = {"WIREFRAME", "RASTERISE", "RAYTRACE_P", "RAYTRACE_D", "SPHERE_W", "SPHERE_G", "SPHERE_P", "RAYTRACE_TM", "RAYTRACE_R", "RAYTRACE_G", "HYBRID", "RAYTRACE_D:QUAD", "RAYTRACE_R:SPHERE", "RAYTRACE_D:LIGHTS", "PATHTRACE", "RAYTRACE_R:AA", "RAYTRACE_R:REPROJECT", "INSTANCES"};
+	// modes that must reproduce another mode's image rather than having a reference of their own
+	const std::map<std::string, std::string> sharedGoldens = {{"HYBRID", "RAYTRACE_R"}};
+	const Scene *scene = loadScene();
+	// the references were recorded at the default size
+	auto depthBuffer = newDepthBuffer(DEFAULT_WIDTH, DEFAULT_HEIGHT);
+	GoldenImage golden = GoldenImage();
+	const RenderSettings defaults = RenderSettings();
+	int failures = 0;
+	for (const auto &mode : modes) {
+		Camera camera = startingCamera();
+		camera.mode = mode.substr(0, mode.find(':'));
+		LightSet lights = LightSet();
+		RenderSettings settings = defaults;
+		settings.antialias = mode.find(":AA") != std::string::npos;
+		if (mode.find(":QUAD") != std::string::npos) lights.current().shape = LightShape::QUAD;
+		if (mode.find(":SPHERE") != std::string::npos) lights.current().shape = LightShape::SPHERE;
+		if (mode.find(":LIGHTS") != std::string::npos) {
+			Light lamp = Light(glm::vec3(-0.5, -0.3, 0.5), 0.3);
+			lamp.range = 1.2;
+			lights.add(lamp);
+			lamp.position = glm::vec3(0.5, -0.5, -0.5);
+			lights.add(lamp);
+		}
+		DrawingWindow window = DrawingWindow(DEFAULT_WIDTH, DEFAULT_HEIGHT);
+		GBuffer gbuffer = GBuffer(window.width, window.height);
+		AccumulationBuffer accumulation = AccumulationBuffer(window.width, window.height);
+		const bool reprojected = mode.find(":REPROJECT") != std::string::npos;
+		const int sweepFrames = 12;
+		TemporalReprojection reprojection = TemporalReprojection();
+		auto sweep = [&](int from) {
+			reprojection.reset();
+			for (int frame = from; frame < sweepFrames; frame++) {
+				camera.setPose(glm::vec3(0,0,4), camera.orientation);
+				camera.orbit(0.01f * frame);
+				camera.lookAt(glm::vec3(0,0,0));
+				FrameArena::resetAll();
+				drawReprojectedRaytraceOBJ(&camera, scene->texture, scene->trianglesFor(camera.mode), lights, settings, &reprojection, &gbuffer, window);
+			}
+		};
+		const bool instancing = mode == "INSTANCES";
+		InstancedScene instanced = InstancedScene();
+		if (instancing) layOutInstances(*scene, 125, instanced);
+		auto render = [&]() {
+			if (reprojected) {
+				sweep(0);
+				return;
+			}
+			if (instancing) {
+				drawInstancedScene(&camera, instanced, lights, window);
+				return;
+			}
+			// the path tracer's reference is a fixed number of accumulated passes from a fresh buffer
+			accumulation.reset();
+			int passes = camera.mode == "PATHTRACE" ? 16 : 1;
+			for (int pass = 0; pass < passes; pass++) {
+				draw(depthBuffer, &camera, *scene, lights, settings, nullptr, &gbuffer, &accumulation, window);
+			}
+		};
+		auto start = std::chrono::steady_clock::now();
+		render();
+		double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		std::string reference = sharedGoldens.count(mode) ? sharedGoldens.at(mode) : mode;
+		std::replace(reference.begin(), reference.end(), ':', '_');
+		std::string filename = "assets/golden/" + reference + ".ppm";
+		std::cout << std::left << std::setw(12) << mode << std::right << std::setw(10) << std::fixed << std::setprecision(1) << ms << " ms  ";
+		if (settings.antialias) {
+			double spp = 1 + double(gbuffer.supersampledPixels) * settings.antialiasSamples / (window.width * window.height);
+			std::cout << "edges " << gbuffer.supersampledPixels << " px (" << std::setprecision(2) << spp << " spp)  " << std::setprecision(1);
+		}
+		if (!update) {
+			// drawing the same view again is the steady state: raytraced modes shade from the cached primary hits
+			// and must give the same frame, and no mode should need the heap any more
+#ifndef NDEBUG
+			unsigned long allocations = AllocationCounter::count();
+#endif
+			start = std::chrono::steady_clock::now();
+			render();
+			ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			std::cout << (camera.raytraced() ? "reshade " : "redraw  ") << std::setw(8) << ms << " ms  ";
+#ifndef NDEBUG
+			allocations = AllocationCounter::count() - allocations;
+			std::cout << "allocs " << std::setw(6) << allocations << "  ";
+#endif
+		}
+		if (update) {
+			if (sharedGoldens.count(mode)) {
+				std::cout << "shares " << filename << std::endl;
+				continue;
+			}
+			window.savePPM(filename);
+			std::cout << "recorded " << filename << std::endl;
+			continue;
+		}
+		GoldenResult result = golden.compare(window, filename);
+		if (!result.loaded) {
+			std::cout << "MISSING " << filename << std::endl;
+			failures++;
+			continue;
+		}
+		std::cout << "PSNR " << std::setw(6) << std::setprecision(2) << result.psnr << " dB  mismatched " << result.mismatchedPixels << "  max diff " << result.maxDifference << "  " << (result.passed ? "PASS" : "FAIL") << std::endl;
+		if (!result.passed) failures++;
+		if (settings.antialias) {
+			// refining progressively has to finish on the same anti-aliased frame
+			ProgressiveRefinement progressive = ProgressiveRefinement();
+			progressive.enabled = true;
+			while (!progressive.finished()) draw(depthBuffer, &camera, *scene, lights, settings, &progressive, &gbuffer, &accumulation, window);
+			GoldenResult refined = golden.compare(window, filename);
+			std::cout << std::setw(12) << "" << "  refined progressively:  PSNR " << std::setw(6) << refined.psnr << " dB  mismatched " << refined.mismatchedPixels
+					<< "  max diff " << refined.maxDifference << "  " << (refined.passed ? "PASS" : "FAIL") << std::endl;
+			if (!refined.passed) failures++;
+		}
+		if (reprojected) {
+			// pixels carried forward from different histories can differ by up to what reprojection lets reuse drift
+			// by, so the restarted frame only has to be close
+			sweep(sweepFrames / 2);
+			GoldenResult restarted = GoldenImage(8, 40, 0.02).compare(window, filename);
+			std::cout << std::setw(12) << "" << "  history restarted at frame " << sweepFrames / 2 << ":  PSNR " << std::setw(6) << restarted.psnr << " dB  mismatched " << restarted.mismatchedPixels
+					<< "  max diff " << restarted.maxDifference << "  " << (restarted.passed ? "PASS" : "FAIL") << std::endl;
+			if (!restarted.passed) failures++;
+		}
+		if (instancing) {
+			InstancedScene flattened = InstancedScene();
+			flattened.addInstance(flattened.addMesh(flattenInstances(instanced)), glm::mat4(1));
+			const std::vector<std::pair<BVHMethod, std::string>> methods = {{BVHMethod::MEDIAN, "MEDIAN"}, {BVHMethod::SAH, "SAH"}, {BVHMethod::LBVH, "LBVH"}};
+			for (const auto &method : methods) {
+				instanced.meshMethod = instanced.topLevelMethod = flattened.meshMethod = method.first;
+				instanced.rebuild();
+				flattened.rebuild();
+				int tested, flattenedTested;
+				const int mismatches = checkInstancedRays(&camera, instanced, lights, window.width, window.height, tested)
+						+ checkInstancedRays(&camera, flattened, lights, window.width, window.height, flattenedTested);
+				std::cout << std::setw(12) << "" << "  " << std::left << std::setw(6) << method.second << std::right << " walks against every triangle:  " << mismatches << " of "
+						<< tested + flattenedTested << " rays disagree  " << (mismatches == 0 ? "PASS" : "FAIL") << std::endl;
+				if (mismatches > 0) failures++;
+			}
+		}
+	}
+	delete depthBuffer;
+	delete scene;
+	std::cout << (failures == 0 ? "all modes match their golden images" : std::to_string(failures) + " mode(s) failed") << std::endl;
+	return failures == 0 ? 0 : 1;
+}
+
+// Times one frame per mode at a range of sizes, from a thumbnail up to 4K, to show how each mode scales with pixel count
+// Run from the build directory: ./Schungus --benchmark [MODE...]
+int runResolutionBenchmark(std::vector<std::string> modes) {
+	if (modes.empty()) modes = {"RASTERISE", "RAYTRACE_D", "RAYTRACE_R", "HYBRID", "SPHERE_P"};
+	const std::vector<std::pair<int, int>> resolutions = {{160, 128}, {320, 256}, {500, 400}, {1000, 800}, {1920, 1080}, {3840, 2160}};
+	const Scene *scene = loadScene();
+	const RenderSettings settings = RenderSettings();
+	const LightSet lights = LightSet();
+	std::cout << std::left << std::setw(12) << "mode" << std::setw(11) << "size" << std::right << std::setw(10) << "ms" << std::setw(12) << "ns/pixel" << std::endl;
+	for (const auto &mode : modes) {
+		for (const auto &resolution : resolutions) {
+			Camera camera = startingCamera();
+			camera.mode = mode;
+			DrawingWindow window = DrawingWindow(resolution.first, resolution.second);
+			GBuffer gbuffer = GBuffer(window.width, window.height);
+			AccumulationBuffer accumulation = AccumulationBuffer(window.width, window.height);
+			auto depthBuffer = newDepthBuffer(window.width, window.height);
+			auto start = std::chrono::steady_clock::now();
+			draw(depthBuffer, &camera, *scene, lights, settings, nullptr, &gbuffer, &accumulation, window);
+			double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			std::string size = std::to_string(resolution.first) + "x" + std::to_string(resolution.second);
+			std::cout << std::left << std::setw(12) << mode << std::setw(11) << size << std::right << std::setw(10) << std::fixed << std::setprecision(1) << ms << std::setw(12) << ms * 1e6 / (window.width * window.height) << std::endl;
+			delete depthBuffer;
+		}
+	}
+	delete scene;
+	return 0;
+}
+
+// Renders a single frame of any size offscreen from the starting view and saves it, for stills bigger than the screen
+// Run from the build directory: ./Schungus --still WIDTHxHEIGHT [MODE] [FILE.ppm]
+int renderStill(const std::string &resolution, const std::string &mode, const std::string &filename) {
+	Camera camera = Camera();
+	DrawingWindow window = DrawingWindow();
+	if (!setUpOffscreen(resolution, camera, window)) return 1;
+	const Scene *scene = loadScene();
+	camera.mode = mode;
+	GBuffer gbuffer = GBuffer(window.width, window.height);
+	AccumulationBuffer accumulation = AccumulationBuffer(window.width, window.height);
+	auto depthBuffer = newDepthBuffer(window.width, window.height);
+	const RenderSettings settings = RenderSettings();
+	const LightSet lights = LightSet();
+	// the path tracer needs more than one pass to be worth keeping
+	int passes = mode == "PATHTRACE" ? 64 : 1;
+	for (int pass = 0; pass < passes; pass++) {
+		draw(depthBuffer, &camera, *scene, lights, settings, nullptr, &gbuffer, &accumulation, window);
+	}
+	window.savePPM(filename);
+	std::cout << "saved " << window.width << "x" << window.height << " " << mode << " to " << filename << std::endl;
+	delete depthBuffer;
+	delete scene;
+	return 0;
+}
+
+// Traces pixel (x, y) of a width x height frame on its own, giving what the full frame renderers would: the average of
+// passes path traced samples in PATHTRACE, the shaded primary hit in the other raytraced modes
+uint32_t traceStandalonePixel(Camera *camera, int x, int y, size_t width, size_t height, const Scene &scene, const LightSet &lights, const RenderSettings &settings, int passes) {
+	const std::vector<ModelTriangle> &triangles = scene.trianglesFor(camera->mode);
+	GBufferSample sample = GBufferSample();
+	tracePrimaryRay(camera, x + 0.5f, y + 0.5f, width, height, triangles, sample);
+	if (camera->mode != "PATHTRACE") {
+		Random random = Random(Random::seedFor(x, y, 0));
+		return shadeSample(camera, sample, scene.texture, triangles, lights, settings, random).asARGB();
+	}
+	glm::vec3 sum = glm::vec3(0);
+	for (int pass = 0; sample.hit && pass < passes; pass++) {
+		Random random = Random(Random::seedFor(x, y, pass));
+		sum += tracePath(camera, sample, triangles, lights, settings, random);
+	}
+	glm::vec3 colour = glm::min(sum / static_cast<float>(passes), glm::vec3(1, 1, 1)) * 255.0f;
+	return Colour(colour.x, colour.y, colour.z).asARGB();
+}
+
+// The worker side of renderTiles: loads the scene from the cache the coordinator wrote, then renders each tile it's
+// asked for on stdin and streams it back on stdout until stdin closes
+int runTileWorker(const std::string &cache, const std::string &resolution, const std::string &mode, int passes) {
+	std::FILE *stream = claimStdoutForFrames();
+	int width, height;
+	const Scene *scene = loadSceneCache(cache);
+	if (stream == nullptr || scene == nullptr || !parseResolution(resolution, width, height)) return 1;
+	Camera camera = startingCamera();
+	camera.mode = mode;
+	const RenderSettings settings = RenderSettings();
+	const LightSet lights = LightSet();
+	std::vector<uint32_t> pixels;
+	int index, x0, y0, tileWidth, tileHeight;
+	while (std::fscanf(stdin, "%d %d %d %d %d", &index, &x0, &y0, &tileWidth, &tileHeight) == 5) {
+		pixels.resize(tileWidth * tileHeight);
+#pragma omp parallel for
+		for (int y = 0; y < tileHeight; y++) {
+			for (int x = 0; x < tileWidth; x++) {
+				pixels[y * tileWidth + x] = traceStandalonePixel(&camera, x0 + x, y0 + y, width, height, *scene, lights, settings, passes);
+			}
+		}
+		if (!writeStreamFrame(stream, index, tileWidth, tileHeight, pixels)) break;
+	}
+	delete scene;
+	return 0;
+}
+
+// Renders one still like renderStill, but split into tileSize tiles that a pool of worker processes take in turn (see
+// TileCoordinator). The scene is parsed once here and shared with the workers through a binary scene cache.
+int renderTiles(const std::string &program, const std::string &resolution, const std::string &mode, const std::string &filename, int workers, int tileSize) {
+	Camera camera = Camera();
+	DrawingWindow window = DrawingWindow();
+	if (!setUpOffscreen(resolution, camera, window)) return 1;
+	camera.mode = mode;
+	if (!camera.raytraced()) {
+		std::cout << mode << " isn't raytraced, so it can't be rendered by tiles" << std::endl;
+		return 1;
+	}
+	const Scene *scene = loadScene();
+	const std::string cache = saveTemporarySceneCache(*scene);
+	delete scene;
+	if (cache.empty()) printMessageAndQuit("Could not write the scene cache to the temp directory", "");
+	// the same number of passes renderStill makes
+	const int passes = mode == "PATHTRACE" ? 64 : 1;
+	// the workers share this machine's cores between them rather than each starting a thread per core
+	const int threads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()) / workers);
+	const std::string command = "OMP_NUM_THREADS=" + std::to_string(threads) + " " + shellQuoted(program) + " --tile-worker " + shellQuoted(cache)
+			+ " " + resolution + " " + shellQuoted(mode) + " " + std::to_string(passes);
+	const int width = window.width, height = window.height;
+	TileCoordinator coordinator(command, width, height, workers, tileSize);
+	const auto start = std::chrono::steady_clock::now();
+	const bool rendered = coordinator.run();
+	// every worker has exited by now, so nothing reads the cache any more
+	std::remove(cache.c_str());
+	if (!rendered) {
+		std::cout << "tiled render failed, the workers could not render every tile" << std::endl;
+		return 1;
+	}
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	for (int y = 0; y < height; y++) {
+		for (int x = 0; x < width; x++) {
+			window.setPixelColour(x, y, coordinator.pixels[y * width + x]);
+		}
+	}
+	window.savePPM(filename);
+	std::cout << "saved " << width << "x" << height << " " << mode << " to " << filename << " in " << std::fixed << std::setprecision(1) << seconds << " s, tiles per worker:";
+	for (int tiles : coordinator.tilesByWorker) std::cout << " " << tiles;
+	std::cout << std::endl;
+	return 0;
+}
+
+// Renders the instancing test scene with count spheres to a PPM and says how much memory instancing saved
+int renderInstances(const std::string &resolution, int count, const std::string &filename) {
+	Camera camera = Camera();
+	DrawingWindow window = DrawingWindow();
+	if (!setUpOffscreen(resolution, camera, window)) return 1;
+	const Scene *scene = loadScene();
+	InstancedScene instanced = InstancedScene();
+	auto start = std::chrono::steady_clock::now();
+	layOutInstances(*scene, count, instanced);
+	const double buildMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	delete scene;
+	const LightSet lights = LightSet();
+	start = std::chrono::steady_clock::now();
+	drawInstancedScene(&camera, instanced, lights, window);
+	const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	window.savePPM(filename);
+	const double megabytes = 1024.0 * 1024.0;
+	std::cout << instanced.instances.size() << " instances of " << instanced.meshes.size() << " meshes: " << instanced.uniqueTriangles() << " triangles stand in for "
+			<< instanced.instancedTriangles() << ", " << std::fixed << std::setprecision(2) << instanced.bytes() / megabytes << " MB against "
+			<< instanced.instancedTriangles() * sizeof(ModelTriangle) / megabytes << " MB flattened" << std::endl;
+	std::cout << "built in " << std::setprecision(1) << buildMilliseconds << " ms, saved " << window.width << "x" << window.height << " to " << filename << " in " << seconds << " s" << std::endl;
+	return 0;
+}
+
+// Boxes around the triangles of a synthetic scan: a bumpy sphere cut into (about) the given number of triangles
+std::vector<BoundingBox> syntheticMeshBounds(size_t triangles) {
+	const int rows = std::max(2, static_cast<int>(std::sqrt(triangles / 4.0))), columns = 2 * rows;
+	auto vertex = [&](int row, int column) {
+		float theta = 3.14159265f * row / rows, phi = 6.2831853f * column / columns;
+		float radius = 1 + 0.05f * std::sin(40 * theta) * std::sin(40 * phi) + 0.002f * (Random::seedFor(row, column, 0) % 1000) / 1000.0f;
+		return radius * glm::vec3(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+	};
+	std::vector<BoundingBox> bounds(2 * static_cast<size_t>(rows) * columns);
+#pragma omp parallel for
+	for (int row = 0; row < rows; row++) {
+		for (int column = 0; column < columns; column++) {
+			glm::vec3 a = vertex(row, column), b = vertex(row, column + 1), c = vertex(row + 1, column), d = vertex(row + 1, column + 1);
+			BoundingBox &upper = bounds[2 * (static_cast<size_t>(row) * columns + column)], &lower = bounds[2 * (static_cast<size_t>(row) * columns + column) + 1];
+			upper.grow(a); upper.grow(b); upper.grow(c);
+			lower.grow(b); lower.grow(c); lower.grow(d);
+		}
+	}
+	return bounds;
+}
+
+// ./Schungus --bvh-benchmark [MAX] builds each kind of BVH over synthetic meshes of 10k triangles up to MAX (10M by
+// default), on one thread and then on as many as OpenMP will use, and prints how long each took, the speedup and how
+// good a tree it made
+int benchmarkBVHBuilds(size_t maxTriangles) {
+	const std::vector<std::pair<BVHMethod, std::string>> methods = {{BVHMethod::MEDIAN, "MEDIAN"}, {BVHMethod::SAH, "SAH"}, {BVHMethod::LBVH, "LBVH"}};
+	int threads = 1;
+#ifdef _OPENMP
+	threads = omp_get_max_threads();
+#endif
+	auto timeBuild = [&](BVH &bvh, const std::vector<BoundingBox> &bounds, BVHMethod method, int buildThreads) {
+#ifdef _OPENMP
+		omp_set_num_threads(buildThreads);
+#endif
+		auto start = std::chrono::steady_clock::now();
+		bvh.build(bounds, method);
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	};
+	std::cout << "building on 1 and " << threads << " threads, cost is the SAH estimate of a ray through the root (lower is better)" << std::endl;
+	for (size_t triangles = 10000; triangles <= maxTriangles; triangles *= 10) {
+		const std::vector<BoundingBox> bounds = syntheticMeshBounds(triangles);
+		for (const auto &method : methods) {
+			BVH bvh = BVH();
+			const double serial = timeBuild(bvh, bounds, method.first, 1);
+			const double parallel = timeBuild(bvh, bounds, method.first, threads);
+			std::cout << std::setw(9) << bounds.size() << " triangles  " << std::left << std::setw(7) << method.second << std::right << std::fixed << std::setprecision(1)
+					<< std::setw(10) << serial << " ms on 1, " << std::setw(8) << parallel << " ms on " << threads << " (" << std::setprecision(2) << serial / parallel << "x)  "
+					<< std::setprecision(1) << std::setw(6) << bounds.size() / parallel / 1000 << " Mtri/s  cost " << std::setprecision(2) << std::setw(7) << bvh.cost()
+					<< "  nodes " << bvh.nodes.size() << std::endl;
+		}
+	}
+#ifdef _OPENMP
+	omp_set_num_threads(threads);
+#endif
+	return 0;
+}
+
+// Animates the instancing test scene for frames frames at 30 fps: the sphere mesh wobbles, which refits its BVH in
+// place, and every sphere bobs and spins, which rebuilds the top level. Frames go where playback frames go.
+int renderAnimatedInstances(const std::string &resolution, int count, int frames) {
+	Camera camera = Camera();
+	DrawingWindow window = DrawingWindow();
+	if (!setUpOffscreen(resolution, camera, window)) return 1;
+	const Scene *scene = loadScene();
+	InstancedScene instanced = InstancedScene();
+	layOutInstances(*scene, count, instanced);
+	delete scene;
+	// the box is instance 0 and mesh 0, the spheres come after it
+	const int sphere = 1;
+	const std::vector<ModelTriangle> rest = instanced.meshes[sphere].triangles;
+	const BoundingBox ball = instanced.meshes[sphere].bvh.nodes[0].bounds;
+	const float radius = 0.5f * (ball.upper.y - ball.lower.y);
+	std::vector<glm::mat4> placements;
+	for (const auto &instance : instanced.instances) placements.push_back(instance.toWorld);
+	const LightSet lights = LightSet();
+	double refitMicroseconds = 0, topLevelMicroseconds = 0, renderMilliseconds = 0;
+	for (int frame = 0; frame < frames; frame++) {
+		const float time = frame / 30.0f;
+		std::vector<ModelTriangle> &triangles = instanced.meshes[sphere].triangles;
+		for (size_t index = 0; index < triangles.size(); index++) {
+			for (int k = 0; k < 3; k++) {
+				glm::vec3 offset = rest[index].vertices[k] - ball.centre();
+				triangles[index].vertices[k] = ball.centre() + offset * (1 + 0.15f * std::sin(6 * offset.y / radius + 8 * time));
+			}
+		}
+		// only the refit is timed, moving the vertices is the animation's job
+		auto start = std::chrono::steady_clock::now();
+		instanced.refitMesh(sphere);
+		auto refitted = std::chrono::steady_clock::now();
+		for (size_t index = 1; index < instanced.instances.size(); index++) {
+			glm::mat4 bob = glm::translate(glm::mat4(1), glm::vec3(0, 0.05f * std::sin(4 * time + index), 0));
+			instanced.setTransform(index, bob * glm::rotate(placements[index], 2 * time, glm::vec3(0, 1, 0)));
+		}
+		instanced.buildTopLevel();
+		auto rebuilt = std::chrono::steady_clock::now();
+		drawInstancedScene(&camera, instanced, lights, window);
+		auto drawn = std::chrono::steady_clock::now();
+		refitMicroseconds += std::chrono::duration<double, std::micro>(refitted - start).count();
+		topLevelMicroseconds += std::chrono::duration<double, std::micro>(rebuilt - refitted).count();
+		renderMilliseconds += std::chrono::duration<double, std::milli>(drawn - rebuilt).count();
+		std::cout << "frame " << outputFrame(frame, window, PlaybackOptions()) << std::endl;
+	}
+	frames = std::max(frames, 1);
+	std::cout << std::fixed << std::setprecision(1) << "per frame: refit " << refitMicroseconds / frames << " us, top level over " << instanced.instances.size()
+			<< " instances " << topLevelMicroseconds / frames << " us, render " << renderMilliseconds / frames << " ms" << std::endl;
+	return 0;
+}
+
+// The render thread and its hand-off live here rather than in main so they can be stopped at exit: Escape and closing
+// the window exit() from inside pollForInputEvents while a frame may still be drawing.
+static RenderHandoff renderHandoff;
+static std::thread renderThread;
+// the camera path being recorded in RECORD mode, which likewise has to be flushed at exit
+static RecordingWriter recorder;
+
+void shutDown() {
+	renderHandoff.stop();
+	if (renderThread.joinable()) renderThread.join();
+	recorder.close();
+}
+
+// The render thread. Draws from the latest snapshot whenever it makes the last frame stale, or while a progressive or
+// path traced image is still refining, and hands each finished frame to the main thread to present. It owns everything
+// a frame is drawn with, so nothing here is shared with input handling apart from the window's back buffer.
+void renderLoop(RenderHandoff *handoff, const Scene &scene, DrawingWindow &window, ResolutionScaler scaler) {
+	RenderSnapshot snapshot = RenderSnapshot();
+	unsigned long seen = 0;
+	handoff->take(snapshot, seen);
+	Camera *camera = &snapshot.camera;
+	const LightSet &lights = snapshot.lights;
+	const RenderSettings &settings = snapshot.settings;
+	ProgressiveRefinement progressive = ProgressiveRefinement();
+	FrameTracker tracker = FrameTracker();
+	// the G-buffer and accumulation buffer are the size frames are rendered at, which is below the window size while
+	// dynamic resolution is scaling the mode down; those frames are drawn into scaledFrame and then upscaled
+	GBuffer gbuffer = GBuffer(window.width, window.height);
+	AccumulationBuffer accumulation = AccumulationBuffer(window.width, window.height);
+	DrawingWindow scaledFrame = DrawingWindow(window.width, window.height);
+	auto depthBuffer = newDepthBuffer(window.width, window.height);
+	auto scaledDepthBuffer = newDepthBuffer(window.width, window.height);
+	auto lastReadout = std::chrono::steady_clock::now();
+	unsigned long sceneRevision = 0;
+	unsigned long reshades = snapshot.reshades;
+	while (!handoff->stopped()) {
+		handoff->take(snapshot, seen);
+		// toggling progressive refinement and the quality settings aren't covered by any revision, but the primary hits are still good.
+		// A progressive raytrace starts its passes over, or pixels it already traced would keep the old settings.
+		if (snapshot.reshades != reshades) {
+			reshades = snapshot.reshades;
+			tracker.reshade();
+			progressive.restart();
+		}
+		if (snapshot.progressive != progressive.enabled) {
+			progressive.enabled = snapshot.progressive;
+			progressive.restart();
+		}
+		scaler.enabled = snapshot.dynamicResolution;
+		// Only redraw when the view, light or scene changed, or a progressive raytrace still has passes left
+		Invalidation change = tracker.update(*camera, lights, sceneRevision);
+		if (change == Invalidation::VISIBILITY) gbuffer.invalidate();
+		if (change != Invalidation::NONE) accumulation.reset();
+		bool refining = progressive.enabled && camera->raytraced() && !progressive.finished();
+		bool accumulating = camera->mode == "PATHTRACE" && accumulation.samples < settings.maxPathSamples;
+		if (change == Invalidation::NONE && !refining && !accumulating && camera->mode != "RECORD") {
+			// publish and stop both wake this, so the timeout is only a backstop
+			handoff->waitForChange(seen, 1000);
+			continue;
+		}
+		size_t frameWidth = scaler.scaled(window.width, camera->mode), frameHeight = scaler.scaled(window.height, camera->mode);
+		if (frameWidth != gbuffer.width || frameHeight != gbuffer.height) {
+			// a new size for this mode: nothing traced at the old size can be reused
+			gbuffer = GBuffer(frameWidth, frameHeight);
+			accumulation = AccumulationBuffer(frameWidth, frameHeight);
+			scaledFrame = DrawingWindow(frameWidth, frameHeight);
+			delete scaledDepthBuffer;
+			scaledDepthBuffer = newDepthBuffer(frameWidth, frameHeight);
+			progressive.restart();
+		}
+		const bool fullSize = frameWidth == window.width && frameHeight == window.height;
+#ifndef NDEBUG
+		unsigned long allocations = AllocationCounter::count();
+#endif
+		double frameMilliseconds;
+		{
+			std::lock_guard<std::mutex> lock(handoff->window);
+			// a progressive pass paints over the last frame, everything else redraws the whole window
+			window.beginBackBuffer(fullSize && progressive.enabled && camera->raytraced() && camera->mode != "PATHTRACE");
+			// only the render itself is timed, the upscale costs the same whatever size the mode renders at
+			auto frameStart = std::chrono::steady_clock::now();
+			draw(fullSize ? depthBuffer : scaledDepthBuffer, camera, scene, lights, settings, &progressive, &gbuffer, &accumulation, fullSize ? window : scaledFrame);
+			frameMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count();
+			if (!fullSize) upscaleFrame(scaledFrame, window);
+		}
+		// progressive passes only trace part of the frame, and a frame that only reshades reuses its primary hits, so
+		// only whole frames drawn from scratch say what this size costs
+		bool wholeFrame = !(progressive.enabled && camera->raytraced()) || camera->mode == "PATHTRACE";
+		if (wholeFrame && change == Invalidation::VISIBILITY && scaler.update(camera->mode, frameMilliseconds)) {
+			std::cout << camera->mode << " now renders at " << scaler.scaled(window.width, camera->mode) << "x" << scaler.scaled(window.height, camera->mode) << " (" << std::fixed << std::setprecision(1) << frameMilliseconds << " ms)" << std::endl;
+			tracker.reshade();
+		}
+#ifndef NDEBUG
+		// once the frame arenas have grown to fit, frames shouldn't touch the heap (the input thread's own allocations
+		// land in the same count, so an occasional one here can be from a key press)
+		allocations = AllocationCounter::count() - allocations;
+		if (allocations > 0) std::cout << "frame made " << allocations << " heap allocations" << std::endl;
+#endif
+		if (accumulating && std::chrono::steady_clock::now() - lastReadout > std::chrono::seconds(1)) {
+			std::cout << accumulation.samples << " spp, " << std::fixed << std::setprecision(2) << accumulation.samplesPerSecond() / 1e6 << " M samples/s" << std::endl;
+			lastReadout = std::chrono::steady_clock::now();
+		}
+		handoff->finishFrame();
+	}
+	delete depthBuffer;
+	delete scaledDepthBuffer;
 }
 
 int main(int argc, char *argv[]) {
+	if (argc > 1 && (std::string(argv[1]) == "--golden" || std::string(argv[1]) == "--golden-update")) {
+		return runGoldenHarness(std::string(argv[1]) == "--golden-update", std::vector<std::string>(argv + 2, argv + argc));
+	}
+	if (argc > 1 && std::string(argv[1]) == "--benchmark") {
+		return runResolutionBenchmark(std::vector<std::string>(argv + 2, argv + argc));
+	}
+	if (argc > 2 && std::string(argv[1]) == "--still") {
+		return renderStill(argv[2], argc > 3 ? argv[3] : "RAYTRACE_R", argc > 4 ? argv[4] : "still.ppm");
+	}
+	// ./Schungus --tiles WIDTHxHEIGHT MODE FILE [WORKERS] [TILE] renders a still across worker processes
+	if (argc > 4 && std::string(argv[1]) == "--tiles") {
+		int workers = 4, tileSize = 64;
+		if ((argc > 5 && !parseInteger(argv[5], "WORKERS", workers)) || (argc > 6 && !parseInteger(argv[6], "TILE", tileSize))) return 1;
+		return renderTiles(argv[0], argv[2], argv[3], argv[4], std::max(workers, 1), std::max(tileSize, 8));
+	}
+	// ./Schungus --instances WIDTHxHEIGHT COUNT FILE renders COUNT instanced spheres in the box
+	if (argc > 4 && std::string(argv[1]) == "--instances") {
+		int count;
+		if (!parseInteger(argv[3], "COUNT", count)) return 1;
+		return renderInstances(argv[2], std::max(count, 0), argv[4]);
+	}
+	if (argc > 1 && std::string(argv[1]) == "--bvh-benchmark") {
+		int maxTriangles = 10000000;
+		if (argc > 2 && !parseInteger(argv[2], "MAX", maxTriangles)) return 1;
+		return benchmarkBVHBuilds(static_cast<size_t>(std::max(maxTriangles, 0)));
+	}
+	// ./Schungus --animate WIDTHxHEIGHT COUNT FRAMES animates COUNT instanced spheres
+	if (argc > 4 && std::string(argv[1]) == "--animate") {
+		int count, frames;
+		if (!parseInteger(argv[3], "COUNT", count) || !parseInteger(argv[4], "FRAMES", frames)) return 1;
+		return renderAnimatedInstances(argv[2], std::max(count, 0), std::max(frames, 0));
+	}
+	if (argc > 5 && std::string(argv[1]) == "--tile-worker") {
+		int passes;
+		if (!parseInteger(argv[5], "PASSES", passes)) return 1;
+		return runTileWorker(argv[2], argv[3], argv[4], passes);
+	}
+	if (argc > 3 && std::string(argv[1]) == "--convert-recording") {
+		return convertTextRecording(argv[2], argv[3]) ? 0 : 1;
+	}
+	// ./Schungus [--resolution WIDTHxHEIGHT] [--frame-time MS] [--playback FILE] [--fps N] [--reproject on|off]
+	// [--video FILE] [--keep-frames on|off] [--workers N] [--keyframe-rate N] opens a window of that size instead of the
+	// default, with --frame-time starts with dynamic resolution holding each mode to that many milliseconds a frame, and
+	// with --playback renders a recording at --fps frames a second (30 by default) instead of running interactively,
+	// reusing shading between frames with --reproject on. Playback saves a BMP per frame to assets/bmps, unless --video
+	// names a file to encode the frames into (.y4m directly, anything else through ffmpeg), in which case --keep-frames on
+	// keeps the images as well. --keyframe-rate sets how many poses a second RECORD keeps, out of 300.
+	// With --workers the playback is split into ranges of --chunk frames (8 by default) rendered by that many worker
+	// processes, each started with --worker-command (this program by default, or e.g. "ssh host path/to/Schungus") and
+	// given its range with --frames FIRST:LAST and --worker on, which makes it stream the frames back on stdout. A worker
+	// that sends no frame for --worker-timeout seconds (600 by default) is killed and its range handed out again.
+	// Each range starts reprojection with no history, so with --reproject on the frames differ slightly from a single
+	// process's playback (by no more than the reuse error reprojection allows itself, see RAYTRACE_R:REPROJECT in
+	// the golden harness)
+	int width = DEFAULT_WIDTH, height = DEFAULT_HEIGHT;
+	ResolutionScaler scaler = ResolutionScaler();
+	std::string playbackFile;
+	PlaybackOptions playbackOptions = PlaybackOptions();
+	int keyframeInterval = 1;
+	std::string videoFile;
+	std::string keepFrames;
+	int workers = 0, chunkFrames = 8, workerTimeout = 600;
+	std::string workerCommand;
+	bool worker = false;
+	for (int k = 1; k + 1 < argc; k += 2) {
+		const std::string option = argv[k];
+		if (option == "--resolution" && !parseResolution(argv[k + 1], width, height)) {
+			std::cout << "expected a size like 1280x720, got " << argv[k + 1] << std::endl;
+			return 1;
+		}
+		if (option == "--frame-time") {
+			double milliseconds;
+			if (!parseNumber(argv[k + 1], "--frame-time", milliseconds)) return 1;
+			scaler = ResolutionScaler(milliseconds);
+		}
+		if (option == "--playback") playbackFile = argv[k + 1];
+		if (option == "--fps") {
+			double framesPerSecond;
+			if (!parseNumber(argv[k + 1], "--fps", framesPerSecond)) return 1;
+			playbackOptions.framesPerSecond = static_cast<float>(std::max(framesPerSecond, 1.0));
+		}
+		if (option == "--video") videoFile = argv[k + 1];
+		if (option == "--keep-frames") keepFrames = argv[k + 1];
+		if (option == "--reproject") playbackOptions.reprojection.enabled = std::string(argv[k + 1]) == "on";
+		if (option == "--frames" && !parseFrameRange(argv[k + 1], playbackOptions.firstFrame, playbackOptions.lastFrame)) {
+			std::cout << "expected a frame range FIRST:LAST with 0 <= FIRST < LAST, like 0:120, got " << argv[k + 1] << std::endl;
+			return 1;
+		}
+		if (option == "--workers" && !parseInteger(argv[k + 1], "--workers", workers)) return 1;
+		if (option == "--worker-command") workerCommand = argv[k + 1];
+		if (option == "--chunk" && !parseInteger(argv[k + 1], "--chunk", chunkFrames)) return 1;
+		if (option == "--worker-timeout" && !parseInteger(argv[k + 1], "--worker-timeout", workerTimeout)) return 1;
+		if (option == "--worker") worker = std::string(argv[k + 1]) == "on";
+		if (option == "--keyframe-rate") {
+			int keyframeRate;
+			if (!parseInteger(argv[k + 1], "--keyframe-rate", keyframeRate)) return 1;
+			keyframeInterval = std::max(300 / std::max(keyframeRate, 1), 1);
+		}
+	}
+	workers = std::max(workers, 0);
+	chunkFrames = std::max(chunkFrames, 1);
+	workerTimeout = std::max(workerTimeout, 1);
+	// a worker's stdout carries its frames back to the coordinator, so it has to be claimed before anything is printed
+	if (worker) playbackOptions.frameStream = claimStdoutForFrames();
+	VideoWriter video;
+	playbackOptions.video = &video;
+	playbackOptions.keepFrames = videoFile.empty() || keepFrames == "on";
+	if (!playbackFile.empty() && workers > 0) {
+		bool hasLight;
+		const CameraPath path = loadCameraPath(playbackFile, hasLight);
+		if (!videoFile.empty() && !video.open(videoFile, width, height, playbackOptions.framesPerSecond)) return 1;
+		if (workerCommand.empty()) {
+			// local workers share this machine's cores between them rather than each starting a thread per core
+			const int threads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()) / workers);
+			workerCommand = "OMP_NUM_THREADS=" + std::to_string(threads) + " " + shellQuoted(argv[0]);
+		}
+		const std::string command = workerCommand + " --playback " + shellQuoted(playbackFile) + " --resolution " + std::to_string(width) + "x" + std::to_string(height)
+				+ " --fps " + std::to_string(playbackOptions.framesPerSecond) + " --reproject " + (playbackOptions.reprojection.enabled ? "on" : "off");
+		int result = coordinatePlayback(path, command, workers, chunkFrames, workerTimeout, width, height, playbackOptions);
+		if (!video.close()) printMessageAndQuit("Video encoding of " + videoFile + " failed", "");
+		return result;
+	}
 	const auto texture_map = TextureMap("assets/texture.ppm");
 	const std::string filename = "assets/cornell-box.obj";
 	const std::string filename2 = "assets/sphere.obj";
 	auto texture = loadTexture(texture_map);
 	// const std::string filename = "assets/cornell-box copy.obj";
-	auto depthBuffer = newDepthBuffer();
-	Camera c = Camera(glm::vec3(0,0,4), glm::mat3(glm::vec3(1,0,0),glm::vec3(0,1,0),glm::vec3(0,0,1)), 2);
+	auto depthBuffer = newDepthBuffer(width, height);
+	Camera c = startingCamera();
 	Camera *camera = &c;
-	DrawingWindow window = DrawingWindow(WIDTH, HEIGHT, false);
+	// playback never shows its frames, so it renders offscreen
+	DrawingWindow window = playbackFile.empty() ? DrawingWindow(width, height, false) : DrawingWindow(width, height);
 	Light light =  Light();
+	LightSet lights = LightSet({light});
+	ProgressiveRefinement progressive = ProgressiveRefinement();
+	RenderSettings settings = RenderSettings();
 	SDL_Event event;
-	bool playback = false;
+	bool playback = !playbackFile.empty();
 	// drawTexture(texture, window);
 	auto trianglesB = debugParseOBJ(filename, light, texture, 0.35);
 	auto trianglesS = debugParseOBJ(filename2, light, texture, 0.35);
-	float deltaTime = 0.0f;
-	std::vector<std::pair<glm::vec3, glm::mat3>> movements;
+	const Scene scene(std::move(trianglesB), std::move(trianglesS), std::move(texture));
 	if (playback){
-		movements = parseRecording("assets/recording.txt");
-		std::cout << movements.size() << std::endl;
-	}
-	
-	Uint32 lastFrameTime = SDL_GetTicks();
+		bool hasLight;
+		const CameraPath path = loadCameraPath(playbackFile, hasLight);
+		std::cout << path.size() << " poses over " << path.duration() << " s" << std::endl;
+		if (!worker && !videoFile.empty() && !video.open(videoFile, window.width, window.height, playbackOptions.framesPerSecond)) return 1;
+		std::cout << "starting render" << std::endl;
+		doPlayback(camera, path, hasLight, playbackOptions, depthBuffer, scene, lights, window);
+		if (!video.close()) printMessageAndQuit("Video encoding of " + videoFile + " failed", "");
+		if (!videoFile.empty()) std::cout << "wrote " << video.frames() << " frames to " << videoFile << std::endl;
+		std::cout << "done render" << std::endl;
+		exit(0);
+	}
+
+	// Input is sampled on this thread at a fixed rate and frames are drawn on the render thread from snapshots of it,
+	// so a slow raytraced frame no longer holds up key presses or makes the camera jump
+	const Uint32 inputInterval = 5;
+	RenderSnapshot snapshot = RenderSnapshot();
+	snapshot.camera = *camera;
+	snapshot.lights = lights;
+	snapshot.settings = settings;
+	snapshot.dynamicResolution = scaler.enabled;
+	renderHandoff.publish(snapshot);
+	renderThread = std::thread(renderLoop, &renderHandoff, std::cref(scene), std::ref(window), scaler);
+	std::atexit(shutDown);
+	Uint32 lastInput = SDL_GetTicks();
+	// RECORD mode draws a wireframe to steer by, so the recording keeps the mode that was on before it
+	std::string recordedMode = camera->mode;
+	int recordedTicks = 0;
 	while (true) {
-		Uint32 thisFrameTime = SDL_GetTicks();
-		if (camera->mode != "RECORD"){
-			deltaTime = (static_cast<float>(thisFrameTime - lastFrameTime))/1000;
-		} else {
-			deltaTime = 1.0/300;
+		Uint32 tickStart = SDL_GetTicks();
+		// We MUST poll for events - otherwise the window will freeze ! Every queued event gets handled now
+		while (window.pollForInputEvents(event)) {
+			auto key = event.type == SDL_KEYDOWN ? event.key.keysym.sym : SDLK_UNKNOWN;
+			if (event.type == SDL_MOUSEBUTTONDOWN || key == SDLK_u || key == SDLK_y) {
+				// these draw into (or save) the window directly, so they wait for the render thread to finish its frame
+				std::lock_guard<std::mutex> lock(renderHandoff.window);
+				bool ready = renderHandoff.frameReady();
+				window.beginBackBuffer(true);
+				handleEvent(event, depthBuffer, camera, filename, &lights, &settings, &progressive, window);
+				window.swapBuffers();
+				// a finished frame that was waiting went out with this one
+				if (ready) renderHandoff.frameShown();
+				window.presentFrame();
+			} else {
+				handleEvent(event, depthBuffer, camera, filename, &lights, &settings, &progressive, window);
+			}
+			if (key == SDLK_f) {
+				snapshot.dynamicResolution = !snapshot.dynamicResolution;
+				std::cout << "dynamic resolution " << (snapshot.dynamicResolution ? "on, " + std::to_string(static_cast<int>(scaler.targetMilliseconds)) + " ms target" : "off") << std::endl;
+			}
+			if (camera->mode == "RECORD" && !recorder.isOpen()) {
+				if (recorder.open("assets/recording.rnr", RECORDING_HAS_TIME | RECORDING_HAS_LIGHT | RECORDING_HAS_MODE)) std::cout << "recording to assets/recording.rnr" << std::endl;
+				recordedTicks = 0;
+			} else if (camera->mode != "RECORD" && recorder.isOpen()) {
+				std::cout << "recorded " << recorder.count() << " poses" << std::endl;
+				recorder.close();
+			}
+			if (camera->mode != "RECORD") recordedMode = camera->mode;
+			if (key == SDLK_f || key == SDLK_g || key == SDLK_b || key == SDLK_LEFTBRACKET || key == SDLK_RIGHTBRACKET || key == SDLK_COMMA || key == SDLK_PERIOD) snapshot.reshades++;
 		}
-		// We MUST poll for events - otherwise the window will freeze !
-		if (window.pollForInputEvents(event)) handleEvent(event, depthBuffer, camera, filename, &light, window);
-		movement(depthBuffer, camera, window, &light, deltaTime);
-		if (!playback){
-			draw(depthBuffer, camera, trianglesB, trianglesS, texture, &light, window);
+		if (camera->mode != "RECORD") {
+			// held keys move things in fixed steps, however long the loop took to come round
+			for (Uint32 now = SDL_GetTicks(); now - lastInput >= inputInterval; lastInput += inputInterval) {
+				movement(camera, &lights, inputInterval / 1000.0f);
+			}
 		} else {
-			std::cout << "starting render" << std::endl;
-			doPlayback(camera, movements, depthBuffer, trianglesB, trianglesS, texture, &light, window);
-			std::cout << "done render" << std::endl;
-			exit(0);
+			// ticks are 1/300 s apart on the recording's clock and every keyframeInterval-th one keeps its pose, playback
+			// interpolates the rest
+			movement(camera, &lights, 1.0/300);
+			lastInput = SDL_GetTicks();
+			if (recordedTicks % keyframeInterval == 0) {
+				recorder.append(recordedTicks / 300.0f, camera->position, camera->orientation, lights.current().position, recordedMode);
+			}
+			recordedTicks++;
 		}
+		snapshot.camera = *camera;
+		snapshot.lights = lights;
+		snapshot.settings = settings;
+		snapshot.progressive = progressive.enabled;
+		renderHandoff.publish(snapshot);
 		// Need to render the frame at the end, or nothing actually gets shown on the screen !
-		if (camera->mode == "RECORD"){
-			std::ofstream myfile;
-			myfile.open("/home/dustmodebros/CG2024/Weekly Workbooks/01 Introduction and Orientation/extras/RedNoise/assets/recording.txt",std::ios_base::app);
-			myfile << "pos: " << camera->position.x << ", " << camera->position.y << ", " << camera->position.z << std::endl;
-			myfile << "orient1: " << camera->orientation[0].x << ", " << camera->orientation[1].x << ", " << camera->orientation[2].x << std::endl;
-			myfile << "orient2: " << camera->orientation[0].y << ", " << camera->orientation[1].y << ", " << camera->orientation[2].y << std::endl;
-			myfile << "orient3: " << camera->orientation[0].z << ", " << camera->orientation[1].z << ", " << camera->orientation[2].z << std::endl;
-			myfile << std::endl;
-			myfile.close();
-		}
-		window.renderFrame();
-		lastFrameTime = thisFrameTime;
+		if (renderHandoff.frameReady()) {
+			// the finished frame moves to the front buffer, which frees the render thread to start the next one while it's shown
+			window.swapBuffers();
+			renderHandoff.frameShown();
+			window.presentFrame();
+		}
+		Uint32 spent = SDL_GetTicks() - tickStart;
+		if (spent < inputInterval) SDL_Delay(inputInterval - spent);
 	}
 }